@@ -0,0 +1,233 @@
+#ifndef ATOMIC_SHARED_PTR_H_
+#define ATOMIC_SHARED_PTR_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include "shared_ptr.h"
+
+namespace pointers {
+
+// ConcurrentSharedPtr that can be loaded and replaced by many threads
+// at once, e.g. for publishing of read-mostly data.
+// Readers never take a lock. It is done with a split reference count:
+// the current value lives in a Holder, and the atomic word keeps both
+// the address of the holder (lower 48 bits) and the number of readers
+// that are copying the value right now (upper 16 bits).
+// Readers announce themselves with one fetch_add on the word, copy the value,
+// and then take their announcement back. If the holder was replaced
+// in the meantime, the writer has moved the number of announced readers
+// to the holder's own counter, and the last of them deletes the holder.
+template<typename T>
+class AtomicSharedPtr {
+ public:
+  using Pointer = ConcurrentSharedPtr<T>;
+
+  // CONSTRUCTORS
+  AtomicSharedPtr() = default;
+  explicit AtomicSharedPtr(Pointer value);
+  AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+  AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+  // DELETING OPERATORS
+  ~AtomicSharedPtr();
+
+  // ATOMIC OPERATIONS
+  Pointer Load() const;
+  void Store(Pointer desired);
+  Pointer Exchange(Pointer desired);
+  // Replaces the value with `desired` if it is equal to `expected`,
+  // otherwise writes the current value to `expected`.
+  bool CompareExchange(Pointer& expected, Pointer desired);
+
+  bool IsLockFree() const {
+    return word_.is_lock_free();
+  }
+
+ private:
+  struct Holder {
+    explicit Holder(Pointer passed_value) : value(std::move(passed_value)) {}
+
+    Pointer value;
+    // Readers that have left after the holder was replaced subtract one,
+    // the writer that replaced it adds the number of announced readers.
+    std::atomic<std::int64_t> released_readers{0};
+  };
+
+  static constexpr int kPointerBits = 48;
+  static constexpr std::uint64_t kOneReader = std::uint64_t{1} << kPointerBits;
+  static constexpr std::uint64_t kPointerMask = kOneReader - 1;
+
+  static std::uint64_t MakeWord(Holder* holder) {
+    std::uint64_t address = reinterpret_cast<std::uintptr_t>(holder);
+    assert((address & ~kPointerMask) == 0);
+    return address;
+  }
+  static Holder* GetHolder(std::uint64_t word) {
+    return reinterpret_cast<Holder*>(
+        static_cast<std::uintptr_t>(word & kPointerMask));
+  }
+  static std::int64_t GetReaders(std::uint64_t word) {
+    return static_cast<std::int64_t>(word >> kPointerBits);
+  }
+  static bool IsEmpty(const Pointer& value) {
+    return value.Get() == nullptr && value.GetCounter() == 0;
+  }
+
+  // Announces a reader and returns the holder that it is protecting.
+  Holder* Acquire() const;
+  // Takes back the announcement made by Acquire().
+  void Release(Holder* holder) const;
+  // Called by the writer that has taken `old_word` out of the atomic word.
+  static void Retire(std::uint64_t old_word, std::int64_t own_readers);
+  static void AddReleased(Holder* holder, std::int64_t count);
+
+  mutable std::atomic<std::uint64_t> word_{0};
+};
+
+static_assert(sizeof(void*) == 8,
+              "AtomicSharedPtr keeps addresses in 48 bits of a 64-bit word");
+
+// CONSTRUCTORS
+
+template<typename T>
+AtomicSharedPtr<T>::AtomicSharedPtr(Pointer value) {
+  if (!IsEmpty(value)) {
+    word_.store(MakeWord(new Holder(std::move(value))),
+                std::memory_order_release);
+  }
+}
+
+// DELETING OPERATORS
+
+template<typename T>
+AtomicSharedPtr<T>::~AtomicSharedPtr() {
+  Retire(word_.load(std::memory_order_acquire), 0);
+}
+
+// ATOMIC OPERATIONS
+
+template<typename T>
+typename AtomicSharedPtr<T>::Pointer AtomicSharedPtr<T>::Load() const {
+  Holder* holder = Acquire();
+  if (holder == nullptr) {
+    return Pointer();
+  }
+  Pointer value = holder->value;
+  Release(holder);
+  return value;
+}
+
+template<typename T>
+void AtomicSharedPtr<T>::Store(Pointer desired) {
+  Exchange(std::move(desired));
+}
+
+template<typename T>
+typename AtomicSharedPtr<T>::Pointer AtomicSharedPtr<T>::Exchange(
+    Pointer desired) {
+  std::uint64_t new_word = 0;
+  if (!IsEmpty(desired)) {
+    new_word = MakeWord(new Holder(std::move(desired)));
+  }
+  std::uint64_t old_word = word_.exchange(new_word, std::memory_order_acq_rel);
+  Holder* old_holder = GetHolder(old_word);
+  if (old_holder == nullptr) {
+    return Pointer();
+  }
+  // Nobody can delete the holder until it is retired.
+  Pointer old_value = old_holder->value;
+  Retire(old_word, 0);
+  return old_value;
+}
+
+template<typename T>
+bool AtomicSharedPtr<T>::CompareExchange(Pointer& expected,
+                                         Pointer desired) {
+  Holder* new_holder = nullptr;
+  while (true) {
+    Holder* holder = Acquire();
+    bool is_equal = (holder == nullptr) ? IsEmpty(expected)
+                                        : (holder->value == expected);
+    if (!is_equal) {
+      expected = (holder == nullptr) ? Pointer() : holder->value;
+      if (holder != nullptr) {
+        Release(holder);
+      }
+      delete new_holder;
+      return false;
+    }
+    if (new_holder == nullptr && !IsEmpty(desired)) {
+      new_holder = new Holder(std::move(desired));
+    }
+    std::uint64_t new_word =
+        (new_holder == nullptr) ? 0 : MakeWord(new_holder);
+    std::uint64_t word = word_.load(std::memory_order_relaxed);
+    while (GetHolder(word) == holder) {
+      if (word_.compare_exchange_weak(word, new_word,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+        // Our own announcement is in the word too.
+        if (holder != nullptr) {
+          Retire(word, 1);
+        }
+        return true;
+      }
+    }
+    // The value was replaced while we were comparing, try again.
+    if (holder != nullptr) {
+      Release(holder);
+    }
+  }
+}
+
+template<typename T>
+typename AtomicSharedPtr<T>::Holder* AtomicSharedPtr<T>::Acquire() const {
+  std::uint64_t word = word_.fetch_add(kOneReader, std::memory_order_acquire);
+  Holder* holder = GetHolder(word);
+  if (holder == nullptr) {
+    // There is nothing to protect, but the announcement must be taken back.
+    Release(nullptr);
+  }
+  return holder;
+}
+
+template<typename T>
+void AtomicSharedPtr<T>::Release(Holder* holder) const {
+  std::uint64_t word = word_.load(std::memory_order_relaxed);
+  while (GetHolder(word) == holder) {
+    if (word_.compare_exchange_weak(word, word - kOneReader,
+                                    std::memory_order_release,
+                                    std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  // Writer has already moved our announcement to the holder.
+  // Announcements made on an empty value are just dropped with it.
+  if (holder != nullptr) {
+    AddReleased(holder, -1);
+  }
+}
+
+template<typename T>
+void AtomicSharedPtr<T>::Retire(std::uint64_t old_word,
+                                std::int64_t own_readers) {
+  Holder* holder = GetHolder(old_word);
+  if (holder == nullptr) {
+    return;
+  }
+  AddReleased(holder, GetReaders(old_word) - own_readers);
+}
+
+template<typename T>
+void AtomicSharedPtr<T>::AddReleased(Holder* holder, std::int64_t count) {
+  if (holder->released_readers.fetch_add(count, std::memory_order_acq_rel) +
+      count == 0) {
+    delete holder;
+  }
+}
+
+}  // namespace pointers
+
+#endif  // ATOMIC_SHARED_PTR_H_
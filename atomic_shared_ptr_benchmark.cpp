@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include "atomic_shared_ptr.h"
+
+using pointers::AtomicCounting;
+using pointers::AtomicSharedPtr;
+using pointers::ConcurrentSharedPtr;
+using pointers::MakeShared;
+
+namespace {
+
+// The first thread also publishes a new value once in a while.
+constexpr int kWriteEvery = 4096;
+
+struct RoutingTable {
+  explicit RoutingTable(int version) : version(version) {}
+  int version;
+  int routes[16] = {};
+};
+
+class MutexSharedPtr {
+ public:
+  ConcurrentSharedPtr<RoutingTable> Load() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return value_;
+  }
+  void Store(ConcurrentSharedPtr<RoutingTable> desired) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_ = std::move(desired);
+  }
+
+ private:
+  std::mutex mutex_;
+  ConcurrentSharedPtr<RoutingTable> value_ =
+      MakeShared<RoutingTable, AtomicCounting>(0);
+};
+
+AtomicSharedPtr<RoutingTable> atomic_table(
+    MakeShared<RoutingTable, AtomicCounting>(0));
+MutexSharedPtr mutex_table;
+
+template<typename Table>
+void ReadMostly(benchmark::State& state, Table& table) {
+  int iteration = 0;
+  for (auto _ : state) {
+    ConcurrentSharedPtr<RoutingTable> current = table.Load();
+    benchmark::DoNotOptimize(current->routes[iteration & 15]);
+    if (state.thread_index() == 0 && ++iteration % kWriteEvery == 0) {
+      table.Store(MakeShared<RoutingTable, AtomicCounting>(iteration));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_AtomicSharedPtrLoad(benchmark::State& state) {
+  ReadMostly(state, atomic_table);
+}
+
+void BM_MutexSharedPtrLoad(benchmark::State& state) {
+  ReadMostly(state, mutex_table);
+}
+
+}  // namespace
+
+BENCHMARK(BM_AtomicSharedPtrLoad)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_MutexSharedPtrLoad)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
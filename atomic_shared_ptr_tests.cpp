@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "atomic_shared_ptr.h"
+
+using pointers::AtomicSharedPtr;
+using pointers::ConcurrentSharedPtr;
+using pointers::MakeShared;
+using pointers::AtomicCounting;
+
+TEST(Test_0, LoadAndStore) {
+  AtomicSharedPtr<int> atomic_ptr;
+  EXPECT_TRUE(atomic_ptr.IsLockFree());
+  EXPECT_TRUE(atomic_ptr.Load() == nullptr);
+  ConcurrentSharedPtr<int> value = MakeShared<int, AtomicCounting>(1);
+  atomic_ptr.Store(value);
+  EXPECT_EQ(value.GetCounter(), 2);
+  ConcurrentSharedPtr<int> loaded = atomic_ptr.Load();
+  EXPECT_TRUE(loaded == value);
+  EXPECT_EQ(value.GetCounter(), 3);
+  atomic_ptr.Store(ConcurrentSharedPtr<int>());
+  EXPECT_TRUE(atomic_ptr.Load() == nullptr);
+  EXPECT_EQ(value.GetCounter(), 2);
+}
+
+TEST(Test_1, ExchangeAndCompareExchange) {
+  ConcurrentSharedPtr<int> first = MakeShared<int, AtomicCounting>(1);
+  ConcurrentSharedPtr<int> second = MakeShared<int, AtomicCounting>(2);
+  AtomicSharedPtr<int> atomic_ptr(first);
+  ConcurrentSharedPtr<int> old_value = atomic_ptr.Exchange(second);
+  EXPECT_TRUE(old_value == first);
+  EXPECT_EQ(first.GetCounter(), 2);
+  ConcurrentSharedPtr<int> expected = first;
+  EXPECT_FALSE(atomic_ptr.CompareExchange(expected, first));
+  EXPECT_TRUE(expected == second);
+  EXPECT_TRUE(atomic_ptr.CompareExchange(expected, first));
+  EXPECT_TRUE(atomic_ptr.Load() == first);
+  EXPECT_EQ(second.GetCounter(), 2);
+  expected.Reset();
+  EXPECT_FALSE(atomic_ptr.CompareExchange(expected, second));
+  EXPECT_TRUE(expected == first);
+}
+
+TEST(Test_2, ConcurrentReadersAndWriters) {
+  struct Config {
+    explicit Config(int version) : version(version), check(-version) {}
+    int version;
+    int check;
+  };
+  AtomicSharedPtr<Config> config(MakeShared<Config, AtomicCounting>(0));
+  std::atomic<bool> stop{false};
+  std::atomic<int> bad_reads{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i) {
+    readers.emplace_back([&]() {
+      int last_version = 0;
+      while (!stop.load()) {
+        ConcurrentSharedPtr<Config> current = config.Load();
+        if (current->version + current->check != 0 ||
+            current->version < last_version) {
+          bad_reads++;
+        }
+        last_version = current->version;
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  std::atomic<int> next_version{1};
+  for (int i = 0; i < 2; ++i) {
+    writers.emplace_back([&]() {
+      for (int j = 0; j < 5000; ++j) {
+        ConcurrentSharedPtr<Config> expected = config.Load();
+        ConcurrentSharedPtr<Config> desired =
+            MakeShared<Config, AtomicCounting>(next_version++);
+        while (expected->version < desired->version &&
+               !config.CompareExchange(expected, desired)) {
+        }
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(bad_reads.load(), 0);
+  EXPECT_EQ(config.Load().GetCounter(), 2);
+}
@@ -0,0 +1,369 @@
+#ifndef BIASED_COUNTING_H_
+#define BIASED_COUNTING_H_
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "owner_counter.h"
+#include "shared_ptr.h"
+
+namespace pointers {
+
+// Biased reference counting: most copies of a pointer are made and dropped
+// by the thread that created the object, so this thread (the owner) changes
+// its own part of the counter without atomic read-modify-write operations.
+// Other threads use the shared part, which is atomic.
+// Both parts are merged when the owner drops its last reference, or when
+// the shared part becomes negative, i.e. other threads have released the
+// references that the owner has handed over to them. In the latter case
+// the manager is queued to the owner, which merges it later (on one of its
+// next releases, in MergeQueued() or at its exit). If the owner has already
+// exited, the manager is merged by the thread that has queued it.
+// After merging the manager is counted only by the shared part.
+//
+// The policy is used only by SharedPtr and WeakPtr:
+//   pointers::SharedPtr<Message, pointers::BiasedCounting> message(...);
+struct BiasedCounting {
+  // Merges all managers queued to the current thread. Long-living
+  // threads that rarely release pointers may call it once in a while.
+  static void MergeQueued();
+};
+
+template<>
+class CounterManager<BiasedCounting>;
+
+// Owner side of biased counting for one thread.
+// It lives while the thread is running or some managers are owned by it.
+class BiasedThreadRecord {
+ public:
+  using Manager = CounterManager<BiasedCounting>;
+
+  BiasedThreadRecord(const BiasedThreadRecord&) = delete;
+  BiasedThreadRecord& operator=(const BiasedThreadRecord&) = delete;
+
+  // Returns nullptr if the thread has already finished, then managers
+  // created by it have no owner.
+  static BiasedThreadRecord* Current();
+  // Doesn't create the record, so it is cheap enough for every operation.
+  static BiasedThreadRecord* CurrentIfExists() {
+    return current_;
+  }
+
+  void AddRef() {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void Release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  // Called by other threads.
+  void Enqueue(Manager* manager);
+  // Called by the owner thread.
+  bool HasQueued() const {
+    return has_queued_.load(std::memory_order_relaxed);
+  }
+  void MergeQueued();
+
+ private:
+  struct Holder {
+    ~Holder();
+  };
+
+  BiasedThreadRecord() = default;
+  ~BiasedThreadRecord() = default;
+
+  static bool& IsThreadFinished() {
+    thread_local bool finished = false;
+    return finished;
+  }
+  // Merges everything queued and gives up the reference of the thread.
+  void Finish();
+
+  static inline thread_local BiasedThreadRecord* current_ = nullptr;
+
+  std::mutex mutex_;
+  std::vector<Manager*> queue_;
+  std::atomic<bool> has_queued_{false};
+  bool finished_ = false;
+  // The thread and every manager that is not merged yet.
+  std::atomic<int> refs_{1};
+};
+
+template<>
+class CounterManager<BiasedCounting> {
+ public:
+  using Policy = BiasedCounting;
+
+  // Manager is always created by its first SharedPtr,
+  // which belongs to the current thread.
+  CounterManager() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kControlBlockAllocated);
+    BiasedThreadRecord* owner = BiasedThreadRecord::Current();
+    owner_.store(owner, std::memory_order_relaxed);
+    if (owner != nullptr) {
+      owner->AddRef();
+      biased_.Store(1);
+    } else {
+      shared_.store(kOne | kMerged, std::memory_order_relaxed);
+    }
+  }
+  CounterManager(const CounterManager&) = delete;
+  CounterManager& operator=(const CounterManager&) = delete;
+  virtual ~CounterManager() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kControlBlockFreed);
+  }
+
+  bool IsConnectedToPtr() const {
+    return AtomicCounting::Load(weak_validity_) > 0;
+  }
+
+  // COUNTERS PROCESSING
+  // Exact only in the owner thread or when nobody else changes it.
+  int GetSharedCounter() const {
+    return biased_.Load() + GetCount(shared_.load(std::memory_order_acquire));
+  }
+  void AddShared() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kStrongIncrement);
+    if (IsOwnedByCurrentThread()) {
+      biased_.Increment();
+      return;
+    }
+    shared_.fetch_add(kOne, std::memory_order_relaxed);
+  }
+  // Fails once no SharedPtr is left, even if the counters are not merged
+  // yet (e.g. the manager waits in the queue of the owner).
+  bool TryAddShared() {
+    int shared = shared_.load(std::memory_order_acquire);
+    if (IsOwnedByCurrentThread()) {
+      // Only the owner merges the counters while it is running,
+      // so nobody can destroy the object concurrently.
+      if (!HasReferences(shared)) {
+        return false;
+      }
+      AddShared();
+      return true;
+    }
+    while (HasReferences(shared)) {
+      if (shared_.compare_exchange_weak(shared, shared + kOne,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        POINTERS_RECORD_REFCOUNT_EVENT(kStrongIncrement);
+        return true;
+      }
+    }
+    return false;
+  }
+  void ReleaseShared() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kStrongDecrement);
+    if (IsOwnedByCurrentThread()) {
+      ReleaseBiased();
+    } else {
+      ReleaseShared(owner_.load(std::memory_order_acquire));
+    }
+  }
+  void AddWeak() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kWeakIncrement);
+    AtomicCounting::Increment(weak_validity_);
+  }
+  void ReleaseWeak() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kWeakDecrement);
+    if (AtomicCounting::Decrement(weak_validity_) == 0) {
+      DeleteManager();
+    }
+  }
+
+ protected:
+  virtual void DeleteObject() = 0;
+  virtual void DeleteManager() = 0;
+
+ private:
+  friend class BiasedThreadRecord;
+
+  // Shared part keeps the counter in its upper bits and two flags.
+  static constexpr int kMerged = 1;
+  static constexpr int kQueued = 2;
+  static constexpr int kOne = 4;
+
+  static int GetCount(int shared) {
+    return shared >> 2;
+  }
+
+  // Until the counters are merged, the shared part alone can be zero or
+  // negative while the owner holds references, so both parts are summed.
+  // `shared` is loaded before biased_, so that biased_ is not older than
+  // the references that the shared part has seen.
+  bool HasReferences(int shared) const {
+    if ((shared & kMerged) != 0) {
+      return GetCount(shared) > 0;
+    }
+    return GetCount(shared) + biased_.Load() > 0;
+  }
+
+  bool IsOwnedByCurrentThread() const {
+    BiasedThreadRecord* owner = owner_.load(std::memory_order_relaxed);
+    return owner != nullptr && owner == BiasedThreadRecord::CurrentIfExists();
+  }
+
+  void ReleaseBiased();
+  void ReleaseShared(BiasedThreadRecord* owner);
+  // Called by the owner, or by anyone after the owner has finished,
+  // when the manager is taken from the queue.
+  void MergeQueued(BiasedThreadRecord* owner);
+
+  void ReleaseObject() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kObjectDestroyed);
+    DeleteObject();
+    ReleaseWeak();
+  }
+
+  // Is reset when the counters are merged. It is set after the flag
+  // in shared_, so the thread that sees nullptr sees the flag as well.
+  std::atomic<BiasedThreadRecord*> owner_{nullptr};
+  // Read by GetSharedCounter() and HasReferences().
+  OwnerCounter<int> biased_;
+  std::atomic<int> shared_{0};
+  AtomicCounting::Counter weak_validity_{1};
+};
+
+// BIASED THREAD RECORD
+
+inline BiasedThreadRecord* BiasedThreadRecord::Current() {
+  if (current_ == nullptr && !IsThreadFinished()) {
+    thread_local Holder holder;
+    current_ = new BiasedThreadRecord();
+  }
+  return current_;
+}
+
+inline BiasedThreadRecord::Holder::~Holder() {
+  BiasedThreadRecord* record = current_;
+  // Releases made during Finish() must take the shared path.
+  current_ = nullptr;
+  IsThreadFinished() = true;
+  record->Finish();
+}
+
+inline void BiasedThreadRecord::Enqueue(Manager* manager) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!finished_) {
+      queue_.push_back(manager);
+      has_queued_.store(true, std::memory_order_relaxed);
+      return;
+    }
+  }
+  // The owner has finished, so its part of the counter won't change anymore.
+  // The mutex makes its last changes visible here.
+  manager->MergeQueued(this);
+}
+
+inline void BiasedThreadRecord::MergeQueued() {
+  std::vector<Manager*> queue;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue.swap(queue_);
+    has_queued_.store(false, std::memory_order_relaxed);
+  }
+  // Every manager holds a reference to this record.
+  for (Manager* manager : queue) {
+    manager->MergeQueued(this);
+  }
+}
+
+inline void BiasedThreadRecord::Finish() {
+  std::vector<Manager*> queue;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    queue.swap(queue_);
+  }
+  for (Manager* manager : queue) {
+    manager->MergeQueued(this);
+  }
+  Release();
+}
+
+inline void BiasedCounting::MergeQueued() {
+  BiasedThreadRecord* record = BiasedThreadRecord::CurrentIfExists();
+  if (record != nullptr && record->HasQueued()) {
+    record->MergeQueued();
+  }
+}
+
+// BIASED COUNTER MANAGER
+
+inline void CounterManager<BiasedCounting>::ReleaseBiased() {
+  int biased = biased_.Decrement();
+  BiasedThreadRecord* owner = owner_.load(std::memory_order_relaxed);
+  if (biased != 0) {
+    if (owner->HasQueued()) {
+      owner->MergeQueued();
+    }
+    return;
+  }
+  int shared = shared_.fetch_add(kMerged, std::memory_order_acq_rel);
+  owner_.store(nullptr, std::memory_order_release);
+  if ((shared & kQueued) != 0) {
+    // The manager is in the queue, so it is finished by MergeQueued().
+    return;
+  }
+  owner->Release();
+  if (GetCount(shared) == 0) {
+    ReleaseObject();
+  }
+}
+
+inline void CounterManager<BiasedCounting>::ReleaseShared(
+    BiasedThreadRecord* owner) {
+  int shared = shared_.load(std::memory_order_relaxed);
+  int updated;
+  do {
+    updated = shared - kOne;
+    if ((shared & kMerged) == 0 && GetCount(updated) < 0) {
+      updated |= kQueued;
+    }
+  } while (!shared_.compare_exchange_weak(shared, updated,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+  if ((updated & kMerged) != 0) {
+    // While the manager is queued, it is finished by MergeQueued().
+    if (GetCount(updated) == 0 && (updated & kQueued) == 0) {
+      ReleaseObject();
+    }
+    return;
+  }
+  if ((updated & kQueued) != 0 && (shared & kQueued) == 0) {
+    // The owner could not have merged the counters before our change,
+    // and after it they are merged by the queue, so `owner` is still alive.
+    owner->Enqueue(this);
+  }
+}
+
+inline void CounterManager<BiasedCounting>::MergeQueued(
+    BiasedThreadRecord* owner) {
+  int count;
+  if (owner_.load(std::memory_order_relaxed) != nullptr) {
+    int biased = biased_.Load();
+    biased_.Store(0);
+    // Sets kMerged and clears kQueued at once.
+    int shared = shared_.fetch_add(biased * kOne + kMerged - kQueued,
+                                   std::memory_order_acq_rel);
+    owner_.store(nullptr, std::memory_order_release);
+    count = GetCount(shared) + biased;
+  } else {
+    // The owner has merged the counters while the manager was queued.
+    count = GetCount(shared_.fetch_sub(kQueued, std::memory_order_acq_rel));
+  }
+  owner->Release();
+  if (count == 0) {
+    ReleaseObject();
+  }
+}
+
+}  // namespace pointers
+
+#endif  // BIASED_COUNTING_H_
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <thread>
+#include "biased_counting.h"
+
+using pointers::AtomicCounting;
+using pointers::BiasedCounting;
+using pointers::MakeShared;
+using pointers::SharedPtr;
+using pointers::SingleThreadedCounting;
+
+namespace {
+
+struct Message {
+  int id = 0;
+  int payload[15] = {};
+};
+
+// Copies that never leave the thread that has created the object,
+// the case biased counting is made for.
+template<typename Policy>
+void BM_CopyOnOwnerThread(benchmark::State& state) {
+  SharedPtr<Message, Policy> message = MakeShared<Message, Policy>();
+  for (auto _ : state) {
+    SharedPtr<Message, Policy> copy = message;
+    benchmark::DoNotOptimize(copy.Get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Policy>
+SharedPtr<Message, Policy> MakeOnOtherThread() {
+  SharedPtr<Message, Policy> message;
+  std::thread([&message]() {
+    message = MakeShared<Message, Policy>();
+  }).join();
+  return message;
+}
+
+// Every thread copies an object created by another one,
+// so biased counting takes its slow path.
+template<typename Policy>
+void BM_CopyOnOtherThread(benchmark::State& state) {
+  static SharedPtr<Message, Policy> message = MakeOnOtherThread<Policy>();
+  for (auto _ : state) {
+    SharedPtr<Message, Policy> copy = message;
+    benchmark::DoNotOptimize(copy.Get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// An object is created, copied a few times and dropped by the same thread.
+template<typename Policy>
+void BM_CreateCopyAndDrop(benchmark::State& state) {
+  for (auto _ : state) {
+    SharedPtr<Message, Policy> message = MakeShared<Message, Policy>();
+    for (int i = 0; i < 8; ++i) {
+      SharedPtr<Message, Policy> copy = message;
+      benchmark::DoNotOptimize(copy.Get());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_CopyOnOwnerThread, SingleThreadedCounting);
+BENCHMARK_TEMPLATE(BM_CopyOnOwnerThread, AtomicCounting)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_CopyOnOwnerThread, BiasedCounting)->ThreadRange(1, 8);
+
+BENCHMARK_TEMPLATE(BM_CopyOnOtherThread, AtomicCounting)->ThreadRange(2, 8);
+BENCHMARK_TEMPLATE(BM_CopyOnOtherThread, BiasedCounting)->ThreadRange(2, 8);
+
+BENCHMARK_TEMPLATE(BM_CreateCopyAndDrop, SingleThreadedCounting);
+BENCHMARK_TEMPLATE(BM_CreateCopyAndDrop, AtomicCounting);
+BENCHMARK_TEMPLATE(BM_CreateCopyAndDrop, BiasedCounting);
+
+BENCHMARK_MAIN();
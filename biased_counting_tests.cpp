@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "biased_counting.h"
+#include "weak_ptr.h"
+
+using pointers::BiasedCounting;
+
+namespace {
+
+template<typename T>
+using BiasedSharedPtr = pointers::SharedPtr<T, BiasedCounting>;
+
+template<typename T>
+using BiasedWeakPtr = pointers::WeakPtr<T, BiasedCounting>;
+
+struct Counted {
+  explicit Counted(std::atomic<int>* destroyed) : destroyed_(destroyed) {}
+  ~Counted() {
+    destroyed_->fetch_add(1);
+  }
+  std::atomic<int>* destroyed_;
+};
+
+}  // namespace
+
+TEST(Test_0, OwnerThread) {
+  std::atomic<int> destroyed{0};
+  {
+    BiasedSharedPtr<Counted> sptr_1(new Counted(&destroyed));
+    BiasedSharedPtr<Counted> sptr_2 = sptr_1;
+    BiasedSharedPtr<Counted> sptr_3 =
+        pointers::MakeShared<Counted, BiasedCounting>(&destroyed);
+    EXPECT_EQ(sptr_1.GetCounter(), 2);
+    sptr_2.Reset();
+    EXPECT_EQ(sptr_1.GetCounter(), 1);
+    EXPECT_EQ(destroyed, 0);
+  }
+  EXPECT_EQ(destroyed, 2);
+}
+
+TEST(Test_1, HandoffToOtherThread) {
+  std::atomic<int> destroyed{0};
+  BiasedSharedPtr<Counted> sptr(new Counted(&destroyed));
+  BiasedSharedPtr<Counted> copy = sptr;
+  std::thread thread([moved = std::move(copy)]() mutable {
+    BiasedSharedPtr<Counted> other_copy = moved;
+    EXPECT_EQ(moved.GetCounter(), 3);
+  });
+  thread.join();
+  // The other thread has released more than it has added, so the manager
+  // is queued to us and the counters are merged on the next release.
+  EXPECT_EQ(sptr.GetCounter(), 1);
+  BiasedSharedPtr<Counted> last = sptr;
+  sptr.Reset();
+  EXPECT_EQ(last.GetCounter(), 1);
+  EXPECT_EQ(destroyed, 0);
+  last.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_2, OwnerFinishedFirst) {
+  std::atomic<int> destroyed{0};
+  BiasedSharedPtr<Counted> sptr;
+  std::thread thread([&sptr, &destroyed]() {
+    BiasedSharedPtr<Counted> local(new Counted(&destroyed));
+    BiasedSharedPtr<Counted> temporary = local;
+    sptr = local;
+  });
+  thread.join();
+  EXPECT_EQ(sptr.GetCounter(), 1);
+  BiasedSharedPtr<Counted> copy = sptr;
+  sptr.Reset();
+  EXPECT_EQ(destroyed, 0);
+  copy.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_3, ExplicitMerging) {
+  std::atomic<int> destroyed{0};
+  BiasedSharedPtr<Counted> sptr(new Counted(&destroyed));
+  std::vector<BiasedSharedPtr<Counted>> copies(8, sptr);
+  std::thread thread([&copies]() {
+    copies.clear();
+  });
+  thread.join();
+  BiasedCounting::MergeQueued();
+  EXPECT_EQ(sptr.GetCounter(), 1);
+  BiasedSharedPtr<Counted> copy = sptr;
+  EXPECT_EQ(sptr.GetCounter(), 2);
+  sptr.Reset();
+  copy.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_4, ConcurrentSharing) {
+  std::atomic<int> destroyed{0};
+  constexpr int kRounds = 200;
+  for (int round = 0; round < kRounds; ++round) {
+    BiasedSharedPtr<Counted> sptr(new Counted(&destroyed));
+    std::vector<BiasedSharedPtr<Counted>> shared(4, sptr);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&shared, i]() {
+        for (int j = 0; j < 100; ++j) {
+          BiasedSharedPtr<Counted> copy = shared[i];
+          BiasedSharedPtr<Counted> other_copy = copy;
+        }
+        shared[i].Reset();
+      });
+    }
+    for (int j = 0; j < 100; ++j) {
+      BiasedSharedPtr<Counted> copy = sptr;
+    }
+    sptr.Reset();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    BiasedCounting::MergeQueued();
+    EXPECT_EQ(destroyed, round + 1);
+  }
+}
+
+TEST(Test_5, WeakPointers) {
+  std::atomic<int> destroyed{0};
+  BiasedWeakPtr<Counted> wptr;
+  {
+    BiasedSharedPtr<Counted> sptr =
+        pointers::MakeShared<Counted, BiasedCounting>(&destroyed);
+    wptr = BiasedWeakPtr<Counted>(sptr);
+    std::thread thread([wptr]() mutable {
+      EXPECT_FALSE(wptr.Expired());
+      BiasedSharedPtr<Counted> locked = wptr.Lock();
+      EXPECT_EQ(locked.GetCounter(), 2);
+    });
+    thread.join();
+    EXPECT_EQ(wptr.GetNumberOfConnectedShared(), 1);
+  }
+  EXPECT_EQ(destroyed, 1);
+  EXPECT_TRUE(wptr.Expired());
+}
+
+TEST(Test_6, LockingQueuedManager) {
+  std::atomic<int> destroyed{0};
+  BiasedSharedPtr<Counted> sptr(new Counted(&destroyed));
+  BiasedWeakPtr<Counted> wptr(sptr);
+  BiasedSharedPtr<Counted> copy = sptr;
+  sptr.Reset();
+  // The other thread releases the last reference, so the manager waits
+  // in our queue with unmerged counters, but the object is already dead.
+  std::thread thread([moved = std::move(copy), wptr]() mutable {
+    moved.Reset();
+    EXPECT_TRUE(wptr.Expired());
+    EXPECT_EQ(wptr.Lock().Get(), nullptr);
+  });
+  thread.join();
+  EXPECT_TRUE(wptr.Expired());
+  EXPECT_EQ(wptr.Lock().Get(), nullptr);
+  EXPECT_EQ(destroyed, 0);
+  BiasedCounting::MergeQueued();
+  EXPECT_EQ(destroyed, 1);
+}
@@ -1,18 +1,112 @@
 #ifndef BIDIRECTIONAL_LIST_H_
 #define BIDIRECTIONAL_LIST_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <cassert>
+#include "node_pool.h"
 
 namespace containers {
 
-template<typename T>
+// Is true if the allocator can free all its nodes at once
+// (see NodePoolAllocator::ReleaseAll()).
+template<typename Allocator, typename = void>
+struct CanReleaseAll : std::false_type {};
+
+template<typename Allocator>
+struct CanReleaseAll<Allocator, std::void_t<decltype(
+    std::declval<Allocator&>().ReleaseAll())>> : std::true_type {};
+
+// Index policies of BiDirectionalList. The list keeps ForNodes<Node>
+// up to date: Add() is called for every node that joins the list,
+// Remove() for every node that leaves it and Clear() when all of them
+// leave at once.
+
+// No index, FindNode() scans the list.
+struct NoIndex {
+  template<typename Node>
+  class ForNodes {
+   public:
+    static constexpr bool kEnabled = false;
+
+    void Add(Node*) {}
+    void Remove(Node*) {}
+    void Clear() {}
+  };
+};
+
+// Hash table from values to their nodes, so FindNode() takes O(1).
+// The table keeps only pointers, the values stay in the nodes.
+template<typename T, typename Hash = std::hash<T>,
+         typename KeyEqual = std::equal_to<T>>
+struct HashIndex {
+  template<typename Node>
+  class ForNodes {
+   public:
+    static constexpr bool kEnabled = true;
+
+    void Add(Node* node) {
+      nodes_.emplace(&node->value, node);
+    }
+    void Remove(Node* node) {
+      auto range = nodes_.equal_range(&node->value);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == node) {
+          nodes_.erase(it);
+          return;
+        }
+      }
+    }
+    void Clear() {
+      nodes_.clear();
+    }
+    // Any of the nodes with the value, nullptr if there are none.
+    Node* Find(const T& value) const {
+      auto it = nodes_.find(&value);
+      return (it != nodes_.end()) ? it->second : nullptr;
+    }
+
+   private:
+    struct ValueHash {
+      std::size_t operator()(const T* value) const {
+        return hash(*value);
+      }
+      Hash hash;
+    };
+    struct ValueEqual {
+      bool operator()(const T* lhs, const T* rhs) const {
+        return equal(*lhs, *rhs);
+      }
+      KeyEqual equal;
+    };
+
+    std::unordered_multimap<const T*, Node*, ValueHash, ValueEqual> nodes_;
+  };
+};
+
+// Nodes are taken from Allocator, rebound to Node.
+// With HashIndex (see IndexedBiDirectionalList) the list also keeps
+// a hash table of its values, which must not be changed in place then.
+// The cursor of operator[] is always on, not a policy: it costs a pointer,
+// an int and a branch per push or pop, too little for BM_PushPop to show.
+template<typename T, typename Allocator = std::allocator<T>,
+         typename Index = NoIndex>
 class BiDirectionalList {
  public:
   struct Node {
    public:
-    friend class BiDirectionalList<T>;
+    friend class BiDirectionalList;
 
     Node() = delete;
     T value;
@@ -24,13 +118,106 @@ class BiDirectionalList {
     Node* next_;
   };
 
+  // Bidirectional iterator over values. end() is a null node, which
+  // remembers its list, so that --end() gives the last value.
+  template<bool IsConst>
+  class Iterator {
+   public:
+    friend class BiDirectionalList;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using NodePointer = std::conditional_t<IsConst, const Node*, Node*>;
+
+    Iterator() = default;
+    // iterator -> const_iterator
+    template<bool OtherIsConst,
+             typename = std::enable_if_t<IsConst && !OtherIsConst>>
+    Iterator(const Iterator<OtherIsConst>& other)
+        : node_(other.node_), list_(other.list_) {}
+
+    reference operator*() const {
+      assert(node_ != nullptr);
+      return node_->value;
+    }
+    pointer operator->() const {
+      assert(node_ != nullptr);
+      return &node_->value;
+    }
+    // Node for the methods that take Node*, nullptr for end().
+    NodePointer GetNode() const {
+      return node_;
+    }
+
+    Iterator& operator++() {
+      node_ = node_->next_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++(*this);
+      return old;
+    }
+    Iterator& operator--() {
+      node_ = (node_ == nullptr) ? list_->back_ : node_->prev_;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      --(*this);
+      return old;
+    }
+
+   private:
+    template<bool>
+    friend class Iterator;
+    template<bool LhsIsConst, bool RhsIsConst>
+    friend bool operator==(const Iterator<LhsIsConst>& lhs,
+                           const Iterator<RhsIsConst>& rhs);
+
+    Iterator(NodePointer node, const BiDirectionalList* list)
+        : node_(node), list_(list) {}
+
+    NodePointer node_ = nullptr;
+    const BiDirectionalList* list_ = nullptr;
+  };
+
+  // An iterator can be compared with a const_iterator.
+  template<bool LhsIsConst, bool RhsIsConst>
+  friend bool operator==(const Iterator<LhsIsConst>& lhs,
+                         const Iterator<RhsIsConst>& rhs) {
+    return lhs.node_ == rhs.node_;
+  }
+  template<bool LhsIsConst, bool RhsIsConst>
+  friend bool operator!=(const Iterator<LhsIsConst>& lhs,
+                         const Iterator<RhsIsConst>& rhs) {
+    return !(lhs == rhs);
+  }
+
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
   // CONSTRUCTORS
   BiDirectionalList() = default;
+  explicit BiDirectionalList(const Allocator& allocator)
+      : allocator_(allocator) {}
   BiDirectionalList(const std::initializer_list<T>& init_list);
-  BiDirectionalList<T>(BiDirectionalList<T>&& rhs) noexcept {
-    (*this) = std::move(rhs);
+  BiDirectionalList(BiDirectionalList&& rhs) noexcept
+      : allocator_(std::move(rhs.allocator_)) {
+    Steal(rhs);
   }
-  BiDirectionalList<T>(const BiDirectionalList<T>& rhs) {
+  BiDirectionalList(const BiDirectionalList& rhs)
+      : allocator_(NodeTraits::select_on_container_copy_construction(
+            rhs.allocator_)) {
     (*this) = rhs;
   }
   ~BiDirectionalList() {
@@ -54,10 +241,51 @@ class BiDirectionalList {
     return back_;
   }
 
+  // ITERATORS
+  iterator begin() {
+    return iterator(front_, this);
+  }
+  const_iterator begin() const {
+    return const_iterator(front_, this);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  iterator end() {
+    return iterator(nullptr, this);
+  }
+  const_iterator end() const {
+    return const_iterator(nullptr, this);
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
   // SEARCHING IN LIST
+  // Both scan the list, with an index only when the value is there.
   int Find(const T& value) const;
   std::vector<int> FindAll(const T& value) const;
+  // Node with the value or nullptr. With an index it takes O(1), but of
+  // equal values any node may be returned, otherwise it is the first one.
+  Node* FindNode(const T& value);
+  const Node* FindNode(const T& value) const;
 
+  // Walks from the front, the back or the node found by the previous
+  // non-const call, whichever is closer, so sequential access is O(1).
+  // The const version doesn't remember the node, so several threads can
+  // call it together.
   Node* operator[](const int& index);
   const Node* operator[](const int& index) const;
 
@@ -95,18 +323,101 @@ class BiDirectionalList {
     InsertAfterCopy(element, std::move(value));
   }
 
+  // MOVING NODES BETWEEN LISTS
+  // Nodes are relinked without copying and allocation, so both lists must
+  // have equal allocators (e.g. copies of one NodePoolAllocator).
+  // With an index, every moved node is also moved between the indexes.
+  // Moves nodes [first, last] of `other` before `position` (to the back,
+  // if it is nullptr). `count` is the number of the moved nodes, if it is
+  // passed, the move takes O(1), otherwise the nodes are counted.
+  void Splice(Node* position, BiDirectionalList& other, Node* first,
+              Node* last, int count = -1);
+  // Moves all nodes of `other`.
+  void Splice(Node* position, BiDirectionalList& other);
+  // Moves `element` of this list before `position` (to the back, if it
+  // is nullptr) in O(1), e.g. to the front on every hit of an LRU cache.
+  void MoveBefore(Node* position, Node* element);
+  // Cuts the list before `element` and returns the tail, which shares
+  // the allocator. Takes O(min(head, tail)) to count the nodes.
+  BiDirectionalList SplitAt(Node* element);
+  // Moves the nodes of sorted `other` to their places in this sorted list.
+  // Of equal values, the ones of this list go first.
+  template<typename Compare = std::less<T>>
+  void MergeSorted(BiDirectionalList& other, Compare comp = Compare());
+
+  // SORTING
+  // Stable merge sort that only relinks nodes and allocates nothing.
+  // `comp` must not throw.
+  template<typename Compare = std::less<T>>
+  void Sort(Compare comp = Compare());
+  // Lists of at least kParallelSortThreshold nodes are cut into
+  // `threads` parts (hardware_concurrency() if 0), which are sorted and
+  // then merged pairwise on their own threads. Smaller lists are sorted
+  // by Sort(). `comp` is called concurrently.
+  static constexpr int kParallelSortThreshold = 1 << 15;
+  template<typename Compare = std::less<T>>
+  void ParallelSort(Compare comp = Compare(), unsigned threads = 0);
+
   // COMPARING OPERATORS
-  bool operator==(const BiDirectionalList<T>& rhs) const;
-  bool operator!=(const BiDirectionalList<T>& rhs) const;
+  bool operator==(const BiDirectionalList& rhs) const;
+  bool operator!=(const BiDirectionalList& rhs) const;
 
   // ASSIGNMENT OPERATORS
-  BiDirectionalList<T>& operator=(const BiDirectionalList<T>& rhs);
-  BiDirectionalList<T>& operator=(BiDirectionalList<T>&& rhs) noexcept;
+  BiDirectionalList& operator=(const BiDirectionalList& rhs);
+  // Moves values one by one (and may throw) if the allocators are not
+  // equal and the allocator of rhs doesn't propagate.
+  BiDirectionalList& operator=(BiDirectionalList&& rhs) noexcept(
+      kIsNothrowMoveAssignable);
 
  private:
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  static constexpr bool kIsNothrowMoveAssignable =
+      NodeTraits::propagate_on_container_move_assignment::value ||
+      NodeTraits::is_always_equal::value;
+
+  using NodeIndex = typename Index::template ForNodes<Node>;
+
+  Node* CreateNode(Node* prev, Node* next, T&& value);
+  void DestroyNode(Node* node);
+  // Destroys the node, which is already removed from the index.
+  void FreeNode(Node* node);
+  struct AllocatorTag {};
+
+  BiDirectionalList(AllocatorTag, const NodeAllocator& allocator)
+      : allocator_(allocator) {}
+
+  // Takes the nodes of rhs, which must use the same allocator.
+  void Steal(BiDirectionalList& rhs);
+  // Links the chain [first, last] before `position` (or to the back).
+  void Link(Node* position, Node* first, Node* last);
+  // Unlinks the chain [first, last], sizes are left to the caller.
+  void Unlink(Node* first, Node* last);
+  // Moves the chain [first, last] of `other` to the index of this list.
+  void TakeIndexed(BiDirectionalList& other, Node* first, Node* last);
+  // Finds the node without moving the cursor.
+  Node* NodeAt(int index) const;
+  // Sorting works on chains linked only by next_ and ended by nullptr,
+  // prev_ is restored by RelinkSorted() at the end.
+  // Sorts `size` nodes from `head`, the node after them goes to `rest`.
+  template<typename Compare>
+  static Node* SortChain(Node* head, int size, Compare& comp, Node** rest);
+  template<typename Compare>
+  static Node* MergeChains(Node* left, Node* right, Compare& comp);
+  void RelinkSorted(Node* head);
+
+  NodeAllocator allocator_;
   Node* front_{nullptr};
   Node* back_{nullptr};
   int size_ = 0;
+  // Node returned by the last operator[] and its index. Methods that
+  // change indexes in an unknown way just forget it. The index is kept
+  // only while there is a cursor, so it can't overflow.
+  Node* cursor_{nullptr};
+  int cursor_index_ = 0;
+  NodeIndex index_;
 
   // Functions, similar to their methods,
   // that work with a copy of the passed object and avoid code duplication.
@@ -118,36 +429,36 @@ class BiDirectionalList {
 };
 
 // GETTERS
-template<typename T>
-int BiDirectionalList<T>::Size() const {
+template<typename T, typename Allocator, typename Index>
+int BiDirectionalList<T, Allocator, Index>::Size() const {
   return size_;
 }
 
-template<typename T>
-bool BiDirectionalList<T>::IsEmpty() const {
+template<typename T, typename Allocator, typename Index>
+bool BiDirectionalList<T, Allocator, Index>::IsEmpty() const {
   return size_ == 0;
 }
 
-template<typename T>
-std::vector<T> BiDirectionalList<T>::ToVector() const {
+template<typename T, typename Allocator, typename Index>
+std::vector<T> BiDirectionalList<T, Allocator, Index>::ToVector() const {
   std::vector<T> vector_of_values;
-  if (size_ == 0) {
-    return vector_of_values;
-  }
-  Node* tmp = front_;
-  vector_of_values.push_back(front_->value);
-  for (int i = 1; i < size_; ++i) {
-    tmp = tmp->next_;
-    vector_of_values.push_back(tmp->value);
+  vector_of_values.reserve(size_);
+  for (const T& value : *this) {
+    vector_of_values.push_back(value);
   }
   return vector_of_values;
 }
 
-template<typename T>
-int BiDirectionalList<T>::Find(const T& value) const {
+template<typename T, typename Allocator, typename Index>
+int BiDirectionalList<T, Allocator, Index>::Find(const T& value) const {
   if (this->IsEmpty()) {
     return -1;
   }
+  if constexpr (NodeIndex::kEnabled) {
+    if (index_.Find(value) == nullptr) {
+      return -1;
+    }
+  }
   Node* tmp = front_;
   for (int i = 0; i < size_; i++) {
     if (tmp->value == value) {
@@ -158,9 +469,15 @@ int BiDirectionalList<T>::Find(const T& value) const {
   return -1;
 }
 
-template<typename T>
-std::vector<int> BiDirectionalList<T>::FindAll(const T& value) const {
+template<typename T, typename Allocator, typename Index>
+std::vector<int> BiDirectionalList<T, Allocator, Index>::FindAll(
+    const T& value) const {
   std::vector<int> indexes_with_value;
+  if constexpr (NodeIndex::kEnabled) {
+    if (index_.Find(value) == nullptr) {
+      return indexes_with_value;
+    }
+  }
   Node* tmp = front_;
   for (int i = 0; i < size_; i++) {
     if (tmp->value == value) {
@@ -171,50 +488,85 @@ std::vector<int> BiDirectionalList<T>::FindAll(const T& value) const {
   return indexes_with_value;
 }
 
-template<typename T>
-BiDirectionalList<T>::BiDirectionalList(const std::initializer_list<T>&
-init_list) {
+template<typename T, typename Allocator, typename Index>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::FindNode(const T& value) {
+  const BiDirectionalList& list = *this;
+  return const_cast<Node*>(list.FindNode(value));
+}
+
+template<typename T, typename Allocator, typename Index>
+const typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::FindNode(const T& value) const {
+  if constexpr (NodeIndex::kEnabled) {
+    return index_.Find(value);
+  } else {
+    for (const Node* tmp = front_; tmp != nullptr; tmp = tmp->next_) {
+      if (tmp->value == value) {
+        return tmp;
+      }
+    }
+    return nullptr;
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+BiDirectionalList<T, Allocator, Index>::BiDirectionalList(
+    const std::initializer_list<T>& init_list) {
   for (auto& value : init_list) {
     this->PushBack(value);
   }
 }
 
-template<typename T>
-void BiDirectionalList<T>::PopBack() {
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::PopBack() {
   assert(size_ > 0);
+  if (cursor_ == back_) {
+    cursor_ = nullptr;
+  }
   if (size_ == 1) {
-    delete back_;
+    DestroyNode(back_);
     front_ = nullptr;
     back_ = nullptr;
     size_--;
     return;
   }
   Node* tmp = back_->prev_;
-  delete back_;
+  DestroyNode(back_);
   back_ = tmp;
   back_->next_ = nullptr;
   --size_;
 }
 
-template<typename T>
-void BiDirectionalList<T>::PopFront() {
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::PopFront() {
   assert(size_ > 0);
+  if (cursor_ == front_) {
+    cursor_ = nullptr;
+  } else if (cursor_ != nullptr) {
+    --cursor_index_;
+  }
   if (size_ == 1) {
-    delete front_;
+    DestroyNode(front_);
     front_ = nullptr;
     back_ = nullptr;
     size_--;
     return;
   }
   Node* tmp = front_->next_;
-  delete front_;
+  DestroyNode(front_);
   front_ = tmp;
   front_->prev_ = nullptr;
   --size_;
 }
-template<typename T>
-void BiDirectionalList<T>::Erase(BiDirectionalList::Node* element) {
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Erase(Node* element) {
   assert(size_ > 0 || element != nullptr);
+  if (element == cursor_ || (element != front_ && element != back_)) {
+    cursor_ = nullptr;
+  } else if (element == front_ && cursor_ != nullptr) {
+    --cursor_index_;
+  }
   Node* before_element = element->prev_;
   Node* after_element = element->next_;
   if (before_element != nullptr) {
@@ -227,107 +579,455 @@ void BiDirectionalList<T>::Erase(BiDirectionalList::Node* element) {
   } else {
     back_ = before_element;
   }
-  delete element;
+  DestroyNode(element);
   size_--;
 }
 
-template<typename T>
-typename BiDirectionalList<T>::Node* BiDirectionalList<T>::operator[](
-    const int& index) {
+template<typename T, typename Allocator, typename Index>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::operator[](const int& index) {
   assert(index >= 0 && index < size_);
-  Node* tmp = front_;
-  int counter = 0;
-  while (tmp != nullptr) {
-    if (counter == index) {
-      return tmp;
-    }
-    tmp = tmp->next_;
-    counter++;
-  }
-  return nullptr;
+  Node* node = NodeAt(index);
+  cursor_ = node;
+  cursor_index_ = index;
+  return node;
 }
 
-template<typename T>
-const typename BiDirectionalList<T>::Node* BiDirectionalList<T>::operator[](
-    const int& index) const {
+template<typename T, typename Allocator, typename Index>
+const typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::operator[](
+        const int& index) const {
   assert(index >= 0 && index < size_);
-  Node* tmp = front_;
-  int counter = 0;
-  while (tmp != nullptr) {
-    if (counter == index) {
-      return tmp;
-    }
-    tmp = tmp->next_;
-    counter++;
+  return NodeAt(index);
+}
+
+template<typename T, typename Allocator, typename Index>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::NodeAt(int index) const {
+  Node* node = front_;
+  int position = 0;
+  if (size_ - 1 - index < index) {
+    node = back_;
+    position = size_ - 1;
+  }
+  if (cursor_ != nullptr &&
+      std::abs(cursor_index_ - index) < std::abs(position - index)) {
+    node = cursor_;
+    position = cursor_index_;
+  }
+  for (; position < index; ++position) {
+    node = node->next_;
   }
-  return nullptr;
+  for (; position > index; --position) {
+    node = node->prev_;
+  }
+  return node;
 }
-template<typename T>
-bool BiDirectionalList<T>::operator==(const BiDirectionalList<T>& rhs) const {
+
+template<typename T, typename Allocator, typename Index>
+bool BiDirectionalList<T, Allocator, Index>::operator==(
+    const BiDirectionalList& rhs) const {
   if ((*this).size_ != rhs.size_) {
     return false;
   }
-  for (int i = 0; i < size_; ++i) {
-    if ((*this)[i]->value != rhs[i]->value) {
+  const Node* lhs_node = front_;
+  const Node* rhs_node = rhs.front_;
+  while (lhs_node != nullptr) {
+    if (lhs_node->value != rhs_node->value) {
       return false;
     }
+    lhs_node = lhs_node->next_;
+    rhs_node = rhs_node->next_;
   }
   return true;
 }
 
-template<typename T>
-bool BiDirectionalList<T>::operator!=(const BiDirectionalList<T>& rhs) const {
+template<typename T, typename Allocator, typename Index>
+bool BiDirectionalList<T, Allocator, Index>::operator!=(
+    const BiDirectionalList& rhs) const {
   return !(*this == rhs);
 }
 
-template<typename T>
-BiDirectionalList<T>&
-    BiDirectionalList<T>::operator=(const BiDirectionalList<T>& rhs) {
+template<typename T, typename Allocator, typename Index>
+BiDirectionalList<T, Allocator, Index>&
+BiDirectionalList<T, Allocator, Index>::operator=(
+    const BiDirectionalList& rhs) {
   if (this == &rhs) {
     return *this;
   }
   this->DeleteAll();
-  Node* tmp = rhs.front_;
-  while (tmp != nullptr) {
-    this->PushBack(tmp->value);
-    tmp = tmp->next_;
+  if constexpr (NodeTraits::propagate_on_container_copy_assignment::value) {
+    allocator_ = rhs.allocator_;
+  }
+  for (const T& value : rhs) {
+    this->PushBack(value);
   }
-  size_ = rhs.size_;
   return *this;
 }
 
-template<typename T>
-BiDirectionalList<T>&
-    BiDirectionalList<T>::operator=(BiDirectionalList<T>&&rhs) noexcept {
+template<typename T, typename Allocator, typename Index>
+BiDirectionalList<T, Allocator, Index>&
+BiDirectionalList<T, Allocator, Index>::operator=(
+    BiDirectionalList&& rhs) noexcept(kIsNothrowMoveAssignable) {
   if (this == &rhs) {
     return *this;
   }
   this->DeleteAll();
+  if constexpr (NodeTraits::propagate_on_container_move_assignment::value) {
+    allocator_ = std::move(rhs.allocator_);
+  } else if (allocator_ != rhs.allocator_) {
+    // Nodes of rhs can't be freed by our allocator, so only values move.
+    for (Node* tmp = rhs.front_; tmp != nullptr; tmp = tmp->next_) {
+      this->PushBack(std::move(tmp->value));
+    }
+    rhs.DeleteAll();
+    return *this;
+  }
+  Steal(rhs);
+  return *this;
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Steal(BiDirectionalList& rhs) {
   size_ = rhs.size_;
   back_ = rhs.back_;
   front_ = rhs.front_;
+  cursor_ = rhs.cursor_;
+  cursor_index_ = rhs.cursor_index_;
+  index_ = std::move(rhs.index_);
+  rhs.index_.Clear();
   rhs.size_ = 0;
   rhs.back_ = nullptr;
   rhs.front_ = nullptr;
-  return *this;
+  rhs.cursor_ = nullptr;
 }
 
-template<typename T>
-void BiDirectionalList<T>::DeleteAll() {
+// MOVING NODES BETWEEN LISTS
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Splice(Node* position,
+                                                    BiDirectionalList& other,
+                                                    Node* first, Node* last,
+                                                    int count) {
+  assert(&other != this && allocator_ == other.allocator_);
+  if (count < 0) {
+    count = 1;
+    for (Node* tmp = first; tmp != last; tmp = tmp->next_) {
+      ++count;
+    }
+  }
+  TakeIndexed(other, first, last);
+  other.Unlink(first, last);
+  other.size_ -= count;
+  other.cursor_ = nullptr;
+  Link(position, first, last);
+  size_ += count;
+  if (position != nullptr) {
+    cursor_ = nullptr;
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Splice(Node* position,
+                                                    BiDirectionalList& other) {
+  if (other.size_ > 0) {
+    Splice(position, other, other.front_, other.back_, other.size_);
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::MoveBefore(Node* position,
+                                                        Node* element) {
+  assert(element != nullptr);
+  if (position == element) {
+    return;
+  }
+  Unlink(element, element);
+  Link(position, element, element);
+  cursor_ = nullptr;
+}
+
+template<typename T, typename Allocator, typename Index>
+BiDirectionalList<T, Allocator, Index>
+BiDirectionalList<T, Allocator, Index>::SplitAt(Node* element) {
+  BiDirectionalList tail(AllocatorTag(), allocator_);
+  if (element == nullptr) {
+    return tail;
+  }
+  // Counting goes from both sides of the cut and stops at the nearer end.
+  Node* forward = element;
+  Node* backward = element->prev_;
+  int steps = 0;
+  while (forward != nullptr && backward != nullptr) {
+    forward = forward->next_;
+    backward = backward->prev_;
+    ++steps;
+  }
+  int tail_size = (forward == nullptr) ? steps : size_ - steps;
+  tail.TakeIndexed(*this, element, back_);
+  tail.front_ = element;
+  tail.back_ = back_;
+  Unlink(element, back_);
+  element->prev_ = nullptr;
+  tail.size_ = tail_size;
+  size_ -= tail_size;
+  if (cursor_index_ >= size_) {
+    cursor_ = nullptr;
+  }
+  return tail;
+}
+
+template<typename T, typename Allocator, typename Index>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, Index>::MergeSorted(
+    BiDirectionalList& other, Compare comp) {
+  assert(&other != this && allocator_ == other.allocator_);
+  if (other.size_ > 0) {
+    TakeIndexed(other, other.front_, other.back_);
+  }
+  Node* node = front_;
+  Node* other_node = other.front_;
+  while (other_node != nullptr) {
+    while (node != nullptr && !comp(other_node->value, node->value)) {
+      node = node->next_;
+    }
+    if (node == nullptr) {
+      Link(nullptr, other_node, other.back_);
+      break;
+    }
+    // The whole run of smaller nodes is linked at once.
+    Node* last = other_node;
+    while (last->next_ != nullptr && comp(last->next_->value, node->value)) {
+      last = last->next_;
+    }
+    Node* next_other = last->next_;
+    Link(node, other_node, last);
+    other_node = next_other;
+  }
+  size_ += other.size_;
+  cursor_ = nullptr;
+  other.front_ = nullptr;
+  other.back_ = nullptr;
+  other.size_ = 0;
+  other.cursor_ = nullptr;
+}
+
+// SORTING
+template<typename T, typename Allocator, typename Index>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, Index>::Sort(Compare comp) {
+  if (size_ < 2) {
+    return;
+  }
+  Node* rest;
+  RelinkSorted(SortChain(front_, size_, comp, &rest));
+}
+
+template<typename T, typename Allocator, typename Index>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, Index>::ParallelSort(Compare comp,
+                                                          unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (size_ < kParallelSortThreshold || threads == 1) {
+    Sort(comp);
+    return;
+  }
+  std::size_t parts = std::min<std::size_t>(threads, size_);
+  std::vector<Node*> chains(parts);
+  std::vector<int> sizes(parts);
+  Node* node = front_;
+  for (std::size_t i = 0; i < parts; ++i) {
+    chains[i] = node;
+    sizes[i] = static_cast<int>(size_ / parts + (i < size_ % parts));
+    for (int j = 0; j < sizes[i]; ++j) {
+      node = node->next_;
+    }
+  }
+  // Every part is sorted, then neighbours are merged, and so on, with
+  // the calling thread taking the first task of every round. Tasks of
+  // the threads that can't be started are run by the calling thread too,
+  // so every round is finished and the list is always relinked.
+  auto run_round = [&](std::size_t tasks, auto task) {
+    std::vector<std::thread> workers;
+    std::size_t started = 1;
+    try {
+      workers.reserve(tasks - 1);
+      for (; started < tasks; ++started) {
+        workers.emplace_back(task, started);
+      }
+    } catch (...) {
+    }
+    for (std::size_t i = started; i < tasks; ++i) {
+      task(i);
+    }
+    task(0);
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  };
+  run_round(parts, [&](std::size_t i) {
+    Compare part_comp = comp;
+    Node* rest;
+    chains[i] = SortChain(chains[i], sizes[i], part_comp, &rest);
+  });
+  for (std::size_t step = 1; step < parts; step *= 2) {
+    std::size_t tasks = (parts - step + 2 * step - 1) / (2 * step);
+    run_round(tasks, [&, step](std::size_t i) {
+      Compare part_comp = comp;
+      std::size_t left = 2 * step * i;
+      chains[left] = MergeChains(chains[left], chains[left + step],
+                                 part_comp);
+    });
+  }
+  RelinkSorted(chains[0]);
+}
+
+template<typename T, typename Allocator, typename Index>
+template<typename Compare>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+BiDirectionalList<T, Allocator, Index>::SortChain(Node* head, int size,
+                                                  Compare& comp, Node** rest) {
+  if (size == 1) {
+    *rest = head->next_;
+    head->next_ = nullptr;
+    return head;
+  }
+  Node* middle;
+  Node* left = SortChain(head, size / 2, comp, &middle);
+  Node* right = SortChain(middle, size - size / 2, comp, rest);
+  return MergeChains(left, right, comp);
+}
+
+template<typename T, typename Allocator, typename Index>
+template<typename Compare>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+BiDirectionalList<T, Allocator, Index>::MergeChains(Node* left, Node* right,
+                                                    Compare& comp) {
+  if (left == nullptr || right == nullptr) {
+    return (left != nullptr) ? left : right;
+  }
+  Node* head = nullptr;
+  Node** tail = &head;
+  while (true) {
+    // Equal values are taken from the left, which keeps the sort stable.
+    if (comp(right->value, left->value)) {
+      *tail = right;
+      tail = &right->next_;
+      right = right->next_;
+      if (right == nullptr) {
+        *tail = left;
+        return head;
+      }
+    } else {
+      *tail = left;
+      tail = &left->next_;
+      left = left->next_;
+      if (left == nullptr) {
+        *tail = right;
+        return head;
+      }
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::RelinkSorted(Node* head) {
+  front_ = head;
+  Node* prev = nullptr;
+  for (Node* node = head; node != nullptr; node = node->next_) {
+    node->prev_ = prev;
+    prev = node;
+  }
+  back_ = prev;
+  cursor_ = nullptr;
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Link(Node* position, Node* first,
+                                                  Node* last) {
+  Node* prev = (position != nullptr) ? position->prev_ : back_;
+  first->prev_ = prev;
+  last->next_ = position;
+  if (prev != nullptr) {
+    prev->next_ = first;
+  } else {
+    front_ = first;
+  }
+  if (position != nullptr) {
+    position->prev_ = last;
+  } else {
+    back_ = last;
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::Unlink(Node* first, Node* last) {
+  Node* prev = first->prev_;
+  Node* next = last->next_;
+  if (prev != nullptr) {
+    prev->next_ = next;
+  } else {
+    front_ = next;
+  }
+  if (next != nullptr) {
+    next->prev_ = prev;
+  } else {
+    back_ = prev;
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::TakeIndexed(
+    BiDirectionalList& other, Node* first, Node* last) {
+  if constexpr (NodeIndex::kEnabled) {
+    bool all = (first == other.front_ && last == other.back_);
+    for (Node* node = first; node != last->next_; node = node->next_) {
+      if (!all) {
+        other.index_.Remove(node);
+      }
+      index_.Add(node);
+    }
+    if (all) {
+      other.index_.Clear();
+    }
+  }
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::DeleteAll() {
+  if constexpr (std::is_trivially_destructible<T>::value &&
+                CanReleaseAll<NodeAllocator>::value) {
+    // Nothing to destroy, so all nodes are dropped together with their
+    // chunks without walking over them.
+    if (allocator_.ReleaseAll()) {
+      index_.Clear();
+      cursor_ = nullptr;
+      front_ = nullptr;
+      back_ = nullptr;
+      size_ = 0;
+      return;
+    }
+  }
+  cursor_ = nullptr;
+  index_.Clear();
   Node* tmp = front_;
   Node* tmp2 = tmp;
   while (tmp2 != nullptr) {
     tmp2 = tmp->next_;
-    delete tmp;
+    FreeNode(tmp);
     tmp = tmp2;
   }
   front_ = nullptr;
   back_ = nullptr;
   size_ = 0;
 }
-template<typename T>
-void BiDirectionalList<T>::PushFrontCopy(T value) {
-  Node* value_in_list = new Node(nullptr, front_, std::move(value));
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::PushFrontCopy(T value) {
+  Node* value_in_list = CreateNode(nullptr, front_, std::move(value));
+  if (cursor_ != nullptr) {
+    ++cursor_index_;
+  }
   if (size_ == 0) {
     front_ = value_in_list;
     back_ = value_in_list;
@@ -338,9 +1038,9 @@ void BiDirectionalList<T>::PushFrontCopy(T value) {
   front_ = value_in_list;
   size_++;
 }
-template<typename T>
-void BiDirectionalList<T>::PushBackCopy(T value) {
-  Node* value_in_list = new Node(back_, nullptr, std::move(value));
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::PushBackCopy(T value) {
+  Node* value_in_list = CreateNode(back_, nullptr, std::move(value));
   if (size_ == 0) {
     front_ = value_in_list;
     back_ = value_in_list;
@@ -351,12 +1051,17 @@ void BiDirectionalList<T>::PushBackCopy(T value) {
   back_ = value_in_list;
   size_++;
 }
-template<typename T>
-void BiDirectionalList<T>::InsertBeforeCopy(BiDirectionalList::Node* element,
-                                            T value) {
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::InsertBeforeCopy(Node* element,
+                                                              T value) {
   assert(size_ > 0 && element != nullptr);
-  Node* node_before_element = new Node(element->prev_,
+  Node* node_before_element = CreateNode(element->prev_,
                                        element, std::move(value));
+  if (element != cursor_ && element != front_) {
+    cursor_ = nullptr;
+  } else if (cursor_ != nullptr) {
+    ++cursor_index_;
+  }
   if (element->prev_ == nullptr) {
     front_ = node_before_element;
   } else {
@@ -366,12 +1071,15 @@ void BiDirectionalList<T>::InsertBeforeCopy(BiDirectionalList::Node* element,
   element->prev_ = node_before_element;
   size_++;
 }
-template<typename T>
-void BiDirectionalList<T>::InsertAfterCopy(BiDirectionalList::Node* element,
-                                           T value) {
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::InsertAfterCopy(Node* element,
+                                                             T value) {
   assert(size_ > 0 && element != nullptr);
-  Node* node_after_element = new Node(element, element->next_,
+  Node* node_after_element = CreateNode(element, element->next_,
                                       std::move(value));
+  if (element != cursor_ && element != back_) {
+    cursor_ = nullptr;
+  }
   if (element->next_ == nullptr) {
     back_ = node_after_element;
   } else {
@@ -382,6 +1090,47 @@ void BiDirectionalList<T>::InsertAfterCopy(BiDirectionalList::Node* element,
   size_++;
 }
 
+template<typename T, typename Allocator, typename Index>
+typename BiDirectionalList<T, Allocator, Index>::Node*
+    BiDirectionalList<T, Allocator, Index>::CreateNode(Node* prev, Node* next,
+                                                       T&& value) {
+  Node* node = NodeTraits::allocate(allocator_, 1);
+  try {
+    new (node) Node(prev, next, std::move(value));
+  } catch (...) {
+    NodeTraits::deallocate(allocator_, node, 1);
+    throw;
+  }
+  try {
+    index_.Add(node);
+  } catch (...) {
+    FreeNode(node);
+    throw;
+  }
+  return node;
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::DestroyNode(Node* node) {
+  index_.Remove(node);
+  FreeNode(node);
+}
+
+template<typename T, typename Allocator, typename Index>
+void BiDirectionalList<T, Allocator, Index>::FreeNode(Node* node) {
+  node->~Node();
+  NodeTraits::deallocate(allocator_, node, 1);
+}
+
+// List that takes its nodes from its own NodePoolAllocator.
+template<typename T>
+using PooledBiDirectionalList = BiDirectionalList<T, NodePoolAllocator<T>>;
+
+// List with a hash index of its values (see HashIndex).
+template<typename T, typename Allocator = std::allocator<T>>
+using IndexedBiDirectionalList =
+    BiDirectionalList<T, Allocator, HashIndex<T>>;
+
 }  // namespace containers
 
 
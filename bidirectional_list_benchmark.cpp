@@ -0,0 +1,169 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <list>
+#include <random>
+#include <vector>
+#include "bidirectional_list.h"
+
+// Compares sorting of BiDirectionalList with std::list::sort and with
+// the old way of sorting through ToVector(), insertion of unique
+// values with and without the hash index, and the cost of the
+// operator[] cursor.
+
+using containers::BiDirectionalList;
+using containers::IndexedBiDirectionalList;
+
+namespace {
+
+std::vector<int> RandomValues(std::size_t size) {
+  std::mt19937 generator(42);
+  std::vector<int> values(size);
+  for (int& value : values) {
+    value = static_cast<int>(generator());
+  }
+  return values;
+}
+
+template<typename List>
+List MakeList(const std::vector<int>& values) {
+  List list;
+  for (int value : values) {
+    list.push_back(value);
+  }
+  return list;
+}
+
+template<>
+BiDirectionalList<int> MakeList(const std::vector<int>& values) {
+  BiDirectionalList<int> list;
+  for (int value : values) {
+    list.PushBack(value);
+  }
+  return list;
+}
+
+// Only sorting is timed, the list is rebuilt from the same values
+// before every iteration.
+template<typename List, typename SortFunction>
+void SortBenchmark(benchmark::State& state, SortFunction sort) {
+  std::vector<int> values = RandomValues(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List list = MakeList<List>(values);
+    state.ResumeTiming();
+    sort(list);
+    benchmark::DoNotOptimize(list);
+    state.PauseTiming();
+    list = List();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_StdListSort(benchmark::State& state) {
+  SortBenchmark<std::list<int>>(state, [](std::list<int>& list) {
+    list.sort();
+  });
+}
+
+void BM_Sort(benchmark::State& state) {
+  SortBenchmark<BiDirectionalList<int>>(
+      state, [](BiDirectionalList<int>& list) {
+        list.Sort();
+      });
+}
+
+void BM_ParallelSort(benchmark::State& state) {
+  SortBenchmark<BiDirectionalList<int>>(
+      state, [](BiDirectionalList<int>& list) {
+        list.ParallelSort();
+      });
+}
+
+void BM_SortThroughVector(benchmark::State& state) {
+  SortBenchmark<BiDirectionalList<int>>(
+      state, [](BiDirectionalList<int>& list) {
+        std::vector<int> values = list.ToVector();
+        std::sort(values.begin(), values.end());
+        BiDirectionalList<int> sorted;
+        for (int value : values) {
+          sorted.PushBack(value);
+        }
+        list = std::move(sorted);
+      });
+}
+
+// Every value is pushed only if it isn't in the list yet, half of them
+// are repeated.
+template<typename List>
+void BM_InsertUnique(benchmark::State& state) {
+  std::vector<int> values = RandomValues(state.range(0));
+  for (std::size_t i = 1; i < values.size(); i += 2) {
+    values[i] = values[i / 2];
+  }
+  for (auto _ : state) {
+    List list;
+    for (int value : values) {
+      if (list.FindNode(value) == nullptr) {
+        list.PushBack(value);
+      }
+    }
+    benchmark::DoNotOptimize(list);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Pushes and pops at both ends of a list of range(0) values, with
+// range(1) == 1 after an operator[] in the middle, so every push and pop
+// at the front also moves the cursor index. Compare with range(1) == 0
+// to see what keeping the cursor costs.
+void BM_PushPop(benchmark::State& state) {
+  BiDirectionalList<int> list =
+      MakeList<BiDirectionalList<int>>(RandomValues(state.range(0)));
+  if (state.range(1) != 0) {
+    benchmark::DoNotOptimize(list[list.Size() / 2]);
+  }
+  for (auto _ : state) {
+    list.PushFront(1);
+    list.PushBack(2);
+    list.PopFront();
+    list.PopBack();
+  }
+  benchmark::DoNotOptimize(list);
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+
+// Reads all the values by index, which the cursor makes O(n) in total.
+void BM_IndexedWalk(benchmark::State& state) {
+  BiDirectionalList<int> list =
+      MakeList<BiDirectionalList<int>>(RandomValues(state.range(0)));
+  for (auto _ : state) {
+    long long sum = 0;
+    for (int i = 0; i < list.Size(); ++i) {
+      sum += list[i]->value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+#define SORT_BENCHMARK(name)                                             \
+  BENCHMARK(name)->RangeMultiplier(10)->Range(10000, 10000000)          \
+      ->Unit(benchmark::kMillisecond)->UseRealTime()
+
+SORT_BENCHMARK(BM_StdListSort);
+SORT_BENCHMARK(BM_Sort);
+SORT_BENCHMARK(BM_ParallelSort);
+SORT_BENCHMARK(BM_SortThroughVector);
+
+BENCHMARK_TEMPLATE(BM_InsertUnique, BiDirectionalList<int>)
+    ->Range(1 << 8, 1 << 14);
+BENCHMARK_TEMPLATE(BM_InsertUnique, IndexedBiDirectionalList<int>)
+    ->Range(1 << 8, 1 << 14);
+
+BENCHMARK(BM_PushPop)->Args({1000, 0})->Args({1000, 1});
+BENCHMARK(BM_IndexedWalk)->Range(1 << 8, 1 << 14);
+
+BENCHMARK_MAIN();
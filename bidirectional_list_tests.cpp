@@ -1,6 +1,22 @@
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include "bidirectional_list.h"
 #include <gtest/gtest.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
 TEST(Test_0, InitListTesting) {
   containers::BiDirectionalList<int> list({1, 2, 3, 4, 5});
@@ -176,4 +192,457 @@ TEST(Test_7, MoveChecking) {
   EXPECT_FALSE(list_1 == list_2);
   EXPECT_TRUE(list_1.IsEmpty());
   EXPECT_EQ(list_2.Size(), 5);
-}
\ No newline at end of file
+}
+TEST(Test_8, PooledList) {
+  containers::PooledBiDirectionalList<int> list({1, 2, 3, 4, 5});
+  list.PopFront();
+  list.Erase(list[1]);
+  list.PushBack(6);
+  std::vector<int> exp_list{2, 4, 5, 6};
+  EXPECT_TRUE(exp_list == list.ToVector());
+  containers::PooledBiDirectionalList<int> copy(list);
+  EXPECT_TRUE(copy == list);
+  copy.PushFront(1);
+  containers::PooledBiDirectionalList<int> moved(std::move(copy));
+  EXPECT_EQ(moved.Size(), 5);
+  list = std::move(moved);
+  EXPECT_EQ(list.Size(), 5);
+  list.DeleteAll();
+  EXPECT_TRUE(list.IsEmpty());
+  list.PushBack(7);
+  EXPECT_EQ(list.Front()->value, 7);
+}
+
+TEST(Test_9, PooledListOfStrings) {
+  // Strings are not trivially destructible, so their nodes are destroyed
+  // one by one.
+  containers::PooledBiDirectionalList<std::string> list;
+  for (int i = 0; i < 1000; ++i) {
+    list.PushBack(std::string(32, static_cast<char>('a' + i % 26)));
+  }
+  containers::PooledBiDirectionalList<std::string> copy = list;
+  list.DeleteAll();
+  EXPECT_EQ(copy.Size(), 1000);
+  EXPECT_EQ(copy.Back()->value, std::string(32, 'a' + 999 % 26));
+}
+
+TEST(Test_10, Iterators) {
+  containers::BiDirectionalList<int> list({5, 1, 4, 2, 3});
+  int sum = 0;
+  for (int value : list) {
+    sum += value;
+  }
+  EXPECT_EQ(sum, 15);
+  for (int& value : list) {
+    value *= 10;
+  }
+  std::vector<int> reversed(list.rbegin(), list.rend());
+  std::vector<int> exp_list{30, 20, 40, 10, 50};
+  EXPECT_TRUE(reversed == exp_list);
+  const containers::BiDirectionalList<int>& const_list = list;
+  EXPECT_EQ(*std::max_element(const_list.begin(), const_list.end()), 50);
+  EXPECT_EQ(std::count_if(list.cbegin(), list.cend(),
+                          [](int value) { return value > 25; }), 3);
+  auto found = std::find(list.begin(), list.end(), 40);
+  EXPECT_EQ(found.GetNode(), list[2]);
+  containers::BiDirectionalList<int>::const_iterator const_found = found;
+  EXPECT_TRUE(const_found == std::next(const_list.begin(), 2));
+  EXPECT_EQ(*--list.end(), 30);
+  EXPECT_EQ(std::distance(list.begin(), list.end()), list.Size());
+  list.Erase(found.GetNode());
+  EXPECT_EQ(list.ToVector(), std::vector<int>({50, 10, 20, 30}));
+  containers::BiDirectionalList<int> empty;
+  EXPECT_TRUE(empty.begin() == empty.end());
+  EXPECT_TRUE(empty.rbegin() == empty.rend());
+}
+
+TEST(Test_11, IndexedAccess) {
+  containers::BiDirectionalList<int> list;
+  for (int i = 0; i < 100000; ++i) {
+    list.PushBack(i);
+  }
+  // Quadratic without the cursor.
+  long long sum = 0;
+  for (int i = 0; i < list.Size(); ++i) {
+    sum += list[i]->value;
+  }
+  for (int i = list.Size() - 1; i >= 0; i -= 3) {
+    sum -= list[i]->value;
+  }
+  EXPECT_EQ(sum, 3333266667LL);
+  // The cursor must stay right after every kind of change.
+  std::mt19937 random(20);
+  std::vector<int> exp_list = list.ToVector();
+  for (int step = 0; step < 2000; ++step) {
+    int index = static_cast<int>(random() % exp_list.size());
+    EXPECT_EQ(list[index]->value, exp_list[index]);
+    switch (random() % 6) {
+      case 0:
+        list.PushFront(-step);
+        exp_list.insert(exp_list.begin(), -step);
+        break;
+      case 1:
+        list.PopFront();
+        exp_list.erase(exp_list.begin());
+        break;
+      case 2:
+        list.PopBack();
+        exp_list.pop_back();
+        break;
+      case 3:
+        list.InsertBefore(list[index], -step);
+        exp_list.insert(exp_list.begin() + index, -step);
+        break;
+      case 4:
+        list.InsertAfter(list[index], -step);
+        exp_list.insert(exp_list.begin() + index + 1, -step);
+        break;
+      case 5:
+        list.Erase(list[index]);
+        exp_list.erase(exp_list.begin() + index);
+        break;
+    }
+    index = static_cast<int>(random() % exp_list.size());
+    EXPECT_EQ(list[index]->value, exp_list[index]);
+  }
+  EXPECT_TRUE(list.ToVector() == exp_list);
+}
+
+TEST(Test_12, Splicing) {
+  containers::BiDirectionalList<int> list({1, 2, 3});
+  containers::BiDirectionalList<int> other({10, 20, 30, 40});
+  list.Splice(list[1], other, other[1], other[2], 2);
+  EXPECT_EQ(list.ToVector(), std::vector<int>({1, 20, 30, 2, 3}));
+  EXPECT_EQ(other.ToVector(), std::vector<int>({10, 40}));
+  EXPECT_EQ(list.Size(), 5);
+  EXPECT_EQ(other.Size(), 2);
+  list.Splice(list.Front(), other, other.Back(), other.Back());
+  EXPECT_EQ(list.ToVector(), std::vector<int>({40, 1, 20, 30, 2, 3}));
+  list.Splice(nullptr, other);
+  EXPECT_EQ(list.ToVector(), std::vector<int>({40, 1, 20, 30, 2, 3, 10}));
+  EXPECT_TRUE(other.IsEmpty());
+  EXPECT_EQ(list[6]->value, 10);
+  other.Splice(nullptr, list);
+  EXPECT_EQ(other.Size(), 7);
+  EXPECT_EQ(other.Back()->value, 10);
+  EXPECT_TRUE(list.IsEmpty() && list.Front() == nullptr);
+}
+
+TEST(Test_13, Splitting) {
+  containers::BiDirectionalList<int> list({1, 2, 3, 4, 5, 6});
+  EXPECT_EQ(list[5]->value, 6);
+  containers::BiDirectionalList<int> tail = list.SplitAt(list[4]);
+  EXPECT_EQ(list.ToVector(), std::vector<int>({1, 2, 3, 4}));
+  EXPECT_EQ(tail.ToVector(), std::vector<int>({5, 6}));
+  EXPECT_EQ(list.Size(), 4);
+  EXPECT_EQ(tail.Size(), 2);
+  EXPECT_EQ(list[3]->value, 4);
+  containers::BiDirectionalList<int> head_tail = list.SplitAt(list.Front());
+  EXPECT_TRUE(list.IsEmpty());
+  EXPECT_EQ(head_tail.Size(), 4);
+  EXPECT_TRUE(head_tail.SplitAt(nullptr).IsEmpty());
+  containers::BiDirectionalList<int> last = head_tail.SplitAt(head_tail[1]);
+  EXPECT_EQ(head_tail.ToVector(), std::vector<int>({1}));
+  EXPECT_EQ(last.ToVector(), std::vector<int>({2, 3, 4}));
+  EXPECT_EQ(*--last.end(), 4);
+}
+
+TEST(Test_14, MergingSorted) {
+  using Pair = std::pair<int, char>;
+  auto by_first = [](const Pair& lhs, const Pair& rhs) {
+    return lhs.first < rhs.first;
+  };
+  containers::NodePoolAllocator<Pair> pool;
+  containers::PooledBiDirectionalList<Pair> list(pool);
+  containers::PooledBiDirectionalList<Pair> other(pool);
+  for (Pair value : {Pair(1, 'a'), Pair(3, 'a'), Pair(3, 'b'), Pair(7, 'a')}) {
+    list.PushBack(value);
+  }
+  for (Pair value : {Pair(0, 'c'), Pair(3, 'c'), Pair(4, 'c'), Pair(5, 'c'),
+                     Pair(8, 'c'), Pair(9, 'c')}) {
+    other.PushBack(value);
+  }
+  list.MergeSorted(other, by_first);
+  std::vector<Pair> exp_list{{0, 'c'}, {1, 'a'}, {3, 'a'}, {3, 'b'},
+                             {3, 'c'}, {4, 'c'}, {5, 'c'}, {7, 'a'},
+                             {8, 'c'}, {9, 'c'}};
+  EXPECT_TRUE(list.ToVector() == exp_list);
+  EXPECT_EQ(list.Size(), 10);
+  EXPECT_TRUE(other.IsEmpty());
+  std::reverse(exp_list.begin(), exp_list.end());
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), exp_list.begin()));
+  containers::PooledBiDirectionalList<Pair> tail = list.SplitAt(list[5]);
+  other.MergeSorted(tail, by_first);
+  EXPECT_EQ(other.Size(), 5);
+}
+
+TEST(Test_15, Sorting) {
+  using Pair = std::pair<int, int>;
+  auto by_first = [](const Pair& lhs, const Pair& rhs) {
+    return lhs.first < rhs.first;
+  };
+  containers::BiDirectionalList<Pair> empty;
+  empty.Sort(by_first);
+  EXPECT_TRUE(empty.IsEmpty());
+  std::mt19937 generator(15);
+  std::vector<Pair> values;
+  containers::BiDirectionalList<Pair> list;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back(generator() % 50, i);
+    list.PushBack(values.back());
+  }
+  const Pair* first_node = &list.Front()->value;
+  EXPECT_EQ(list[500]->value, values[500]);
+  list.Sort(by_first);
+  std::stable_sort(values.begin(), values.end(), by_first);
+  EXPECT_TRUE(list.ToVector() == values);
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), values.rbegin()));
+  EXPECT_EQ(list[500]->value, values[500]);
+  EXPECT_EQ(list.Size(), 1000);
+  // Nodes are relinked, not recreated.
+  EXPECT_TRUE(std::any_of(list.begin(), list.end(), [&](const Pair& value) {
+    return &value == first_node;
+  }));
+  list.Sort(std::greater<Pair>());
+  EXPECT_TRUE(std::is_sorted(list.rbegin(), list.rend()));
+}
+
+TEST(Test_16, ParallelSorting) {
+  std::mt19937 generator(16);
+  std::vector<int> values;
+  containers::PooledBiDirectionalList<int> list;
+  const int size = containers::PooledBiDirectionalList<int>::
+      kParallelSortThreshold + 123;
+  for (int i = 0; i < size; ++i) {
+    values.push_back(generator() % 1000);
+    list.PushBack(values.back());
+  }
+  containers::PooledBiDirectionalList<int> copy = list;
+  list.ParallelSort(std::less<int>(), 3);
+  copy.ParallelSort();
+  std::sort(values.begin(), values.end());
+  EXPECT_TRUE(list.ToVector() == values);
+  EXPECT_TRUE(copy.ToVector() == values);
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), values.rbegin()));
+  EXPECT_EQ(list.Back()->value, values.back());
+  containers::BiDirectionalList<int> small({3, 1, 2});
+  small.ParallelSort(std::less<int>(), 4);
+  EXPECT_EQ(small.ToVector(), std::vector<int>({1, 2, 3}));
+}
+
+TEST(Test_17, IndexedList) {
+  containers::BiDirectionalList<int> plain({5, 7, 5});
+  EXPECT_EQ(plain.FindNode(5), plain.Front());
+  EXPECT_EQ(plain.FindNode(8), nullptr);
+  containers::IndexedBiDirectionalList<std::string> list;
+  for (std::string word : {"a", "b", "a", "c", "b", "d"}) {
+    if (list.FindNode(word) == nullptr) {
+      list.PushBack(word);
+    }
+  }
+  EXPECT_EQ(list.ToVector(), std::vector<std::string>({"a", "b", "c", "d"}));
+  EXPECT_EQ(list.FindNode("c"), list[2]);
+  list.Erase(list.FindNode("b"));
+  EXPECT_EQ(list.FindNode("b"), nullptr);
+  EXPECT_EQ(list.Find("b"), -1);
+  EXPECT_TRUE(list.FindAll("b").empty());
+  EXPECT_EQ(list.Find("d"), 2);
+  list.InsertBefore(list.FindNode("c"), "e");
+  list.InsertAfter(list.FindNode("c"), "e");
+  list.PushFront("f");
+  EXPECT_EQ(list.FindAll("e"), std::vector<int>({2, 4}));
+  list.PopFront();
+  list.PopBack();
+  EXPECT_EQ(list.FindNode("f"), nullptr);
+  EXPECT_EQ(list.FindNode("d"), nullptr);
+  EXPECT_EQ(list.ToVector(), std::vector<std::string>({"a", "e", "c", "e"}));
+  list.Erase(list.FindNode("e"));
+  EXPECT_EQ(list.FindNode("e")->value, "e");
+  list.Erase(list.FindNode("e"));
+  EXPECT_EQ(list.FindNode("e"), nullptr);
+
+  containers::IndexedBiDirectionalList<std::string> other({"x", "y", "z"});
+  list.Splice(list.Front(), other, other.FindNode("y"), other.Back());
+  EXPECT_EQ(list.ToVector(),
+            std::vector<std::string>({"y", "z", "a", "c"}));
+  EXPECT_EQ(other.FindNode("y"), nullptr);
+  EXPECT_EQ(list.FindNode("z"), list[1]);
+  containers::IndexedBiDirectionalList<std::string> tail =
+      list.SplitAt(list.FindNode("a"));
+  EXPECT_EQ(list.FindNode("a"), nullptr);
+  EXPECT_EQ(tail.FindNode("a"), tail.Front());
+  list.Sort();
+  tail.MergeSorted(list);
+  EXPECT_EQ(tail.ToVector(),
+            std::vector<std::string>({"a", "c", "y", "z"}));
+  EXPECT_EQ(tail.FindNode("y"), tail[2]);
+  EXPECT_EQ(list.FindNode("y"), nullptr);
+  list.Splice(nullptr, other);
+  EXPECT_EQ(list.FindNode("x"), list.Front());
+  EXPECT_EQ(other.FindNode("x"), nullptr);
+
+  containers::IndexedBiDirectionalList<std::string> copy = tail;
+  EXPECT_EQ(copy.FindNode("c"), copy[1]);
+  containers::IndexedBiDirectionalList<std::string> moved = std::move(tail);
+  EXPECT_EQ(moved.FindNode("c"), moved[1]);
+  EXPECT_EQ(tail.FindNode("c"), nullptr);
+  moved.DeleteAll();
+  EXPECT_EQ(moved.FindNode("c"), nullptr);
+  moved.PushBack("c");
+  EXPECT_EQ(moved.FindNode("c"), moved.Front());
+}
+
+TEST(Test_18, MovingInsideList) {
+  containers::BiDirectionalList<int> list({1, 2, 3, 4});
+  list.MoveBefore(list.Front(), list.Back());
+  EXPECT_EQ(list.ToVector(), std::vector<int>({4, 1, 2, 3}));
+  list.MoveBefore(nullptr, list.Front());
+  EXPECT_EQ(list.ToVector(), std::vector<int>({1, 2, 3, 4}));
+  list.MoveBefore(list[3], list[1]);
+  EXPECT_EQ(list.ToVector(), std::vector<int>({1, 3, 2, 4}));
+  list.MoveBefore(list[2], list[1]);
+  list.MoveBefore(list[0], list[0]);
+  EXPECT_EQ(list.ToVector(), std::vector<int>({1, 3, 2, 4}));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(),
+                         std::vector<int>({4, 2, 3, 1}).begin()));
+  EXPECT_EQ(list.Size(), 4);
+  EXPECT_EQ(list[2]->value, 2);
+}
+
+namespace {
+
+// Stateful allocator that stays with its container.
+template<typename T>
+struct ArenaAllocator {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+  using is_always_equal = std::false_type;
+
+  explicit ArenaAllocator(int arena) : arena(arena) {}
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(std::size_t n) {
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, std::size_t n) {
+    std::allocator<T>().deallocate(ptr, n);
+  }
+  template<typename U>
+  bool operator==(const ArenaAllocator<U>& rhs) const {
+    return arena == rhs.arena;
+  }
+  template<typename U>
+  bool operator!=(const ArenaAllocator<U>& rhs) const {
+    return arena != rhs.arena;
+  }
+
+  int arena;
+};
+
+}  // namespace
+
+TEST(Test_19, MoveAssignmentWithUnequalAllocators) {
+  using List = containers::BiDirectionalList<std::string,
+                                             ArenaAllocator<std::string>>;
+  // Values are moved one by one, which can throw.
+  static_assert(!std::is_nothrow_move_assignable<List>::value);
+  static_assert(std::is_nothrow_move_assignable<
+                containers::BiDirectionalList<int>>::value);
+  static_assert(std::is_nothrow_move_assignable<
+                containers::PooledBiDirectionalList<int>>::value);
+  List first{ArenaAllocator<std::string>(1)};
+  first.PushBack("a");
+  first.PushBack("b");
+  List second{ArenaAllocator<std::string>(2)};
+  second.PushBack("c");
+  second = std::move(first);
+  EXPECT_EQ(second.ToVector(), (std::vector<std::string>{"a", "b"}));
+  EXPECT_TRUE(first.IsEmpty());
+}
+
+TEST(Test_20, MixedIteratorComparison) {
+  containers::BiDirectionalList<int> list({1, 2, 3});
+  containers::BiDirectionalList<int>::const_iterator second =
+      std::next(list.cbegin());
+  EXPECT_TRUE(list.begin() != list.cend());
+  EXPECT_TRUE(list.cbegin() == list.begin());
+  EXPECT_TRUE(std::next(list.begin()) == second);
+  EXPECT_TRUE(second != list.begin());
+  const containers::BiDirectionalList<int>& const_list = list;
+  EXPECT_TRUE(list.rbegin() != const_list.rend());
+  int count = 0;
+  for (auto it = list.begin(); it != list.cend(); ++it) {
+    ++count;
+  }
+  EXPECT_EQ(count, 3);
+}
+
+TEST(Test_21, CursorInQueueUse) {
+  containers::BiDirectionalList<int> list;
+  std::deque<int> expected;
+  for (int i = 0; i < 10; ++i) {
+    list.PushFront(i);
+    expected.push_front(i);
+  }
+  for (int i = 10; i < 1000; ++i) {
+    list.PushFront(i);
+    expected.push_front(i);
+    list.PopBack();
+    expected.pop_back();
+    if (i % 7 == 0) {
+      // Sets the cursor, which the next operations must keep right.
+      EXPECT_EQ(list[i % 10]->value, expected[i % 10]);
+    }
+    if (i % 11 == 0) {
+      list.InsertBefore(list.Front(), -i);
+      expected.push_front(-i);
+      list.Erase(list.Front());
+      expected.pop_front();
+      list.PopFront();
+      expected.pop_front();
+      list.PushFront(i);
+      expected.push_front(i);
+    }
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(list[i]->value, expected[i]);
+  }
+}
+
+#if defined(__linux__) && !defined(__SANITIZE_ADDRESS__)
+// Threads can't be started when there is no address space for their
+// stacks, then the calling thread sorts alone. The limit is set in
+// a new process, so the address space of the tests is not limited and
+// no stacks of finished threads are cached.
+TEST(Test_22, ParallelSortingWithoutThreads) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  containers::BiDirectionalList<int> list;
+  const int size = containers::BiDirectionalList<int>::
+      kParallelSortThreshold * 2;
+  for (int i = 0; i < size; ++i) {
+    list.PushBack(size - i);
+  }
+  auto sort_with_limit = [&list]() {
+    long pages = 0;
+    std::ifstream("/proc/self/statm") >> pages;
+    // Less than a stack of a thread.
+    rlim_t limit = pages * sysconf(_SC_PAGESIZE) + (1 << 20);
+    rlimit address_space{limit, limit};
+    setrlimit(RLIMIT_AS, &address_space);
+    bool started = true;
+    try {
+      std::thread([]() {}).join();
+    } catch (const std::system_error&) {
+      started = false;
+    }
+    list.ParallelSort(std::less<int>(), 4);
+    bool valid = std::is_sorted(list.begin(), list.end()) &&
+                 std::distance(list.begin(), list.end()) == list.Size() &&
+                 std::is_sorted(list.rbegin(), list.rend(),
+                                std::greater<int>());
+    std::exit(!started && valid ? 0 : 1);
+  };
+  EXPECT_EXIT(sort_with_limit(), ::testing::ExitedWithCode(0), "");
+}
+#endif
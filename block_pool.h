@@ -0,0 +1,297 @@
+#ifndef BLOCK_POOL_H_
+#define BLOCK_POOL_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "owner_counter.h"
+
+namespace pointers {
+
+struct BlockPoolStats {
+  std::size_t block_size = 0;
+  std::size_t blocks_per_page = 0;
+  std::size_t pages = 0;
+  std::size_t live_blocks = 0;
+  std::size_t global_free_blocks = 0;
+  // Length of the free list of every thread that uses the pool.
+  std::vector<std::size_t> thread_free_blocks;
+};
+
+// Pages are taken from ::operator new, so this is all the alignment
+// that blocks can get.
+constexpr std::size_t kPageAlignment = alignof(std::max_align_t);
+// Bigger blocks would leave too few of them on a page, see
+// BlockPoolAllocator.
+constexpr std::size_t kMaxPooledBlockSize = 1024;
+
+// Allocator of small blocks of the same size (used for CounterManager-s).
+// Blocks are cut from big pages, so they lie densely in memory.
+// Every thread keeps its own free list and works with the global pool only
+// when its list is empty or too long, moving blocks by whole batches.
+// Pages are never given back to the system, they are reused instead.
+template<std::size_t BlockSize,
+         std::size_t Alignment = alignof(std::max_align_t)>
+class BlockPool {
+ public:
+  static_assert(Alignment >= alignof(void*) && Alignment <= kPageAlignment,
+                "Unsupported alignment of blocks");
+  static constexpr std::size_t kBlockSize =
+      (std::max(BlockSize, sizeof(void*)) + Alignment - 1) /
+      Alignment * Alignment;
+  static constexpr std::size_t kPageSize = 16 * 1024;
+  static constexpr std::size_t kBlocksPerPage = kPageSize / kBlockSize;
+  static constexpr std::size_t kBatchSize = 64;
+  static_assert(kBlocksPerPage > 0, "Blocks must be smaller than pages");
+
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  // Pool is never destroyed, because blocks can be freed by destructors
+  // of static and thread_local objects at any moment of program exit.
+  static BlockPool& Instance() {
+    static BlockPool* pool = new BlockPool();
+    return *pool;
+  }
+
+  void* Allocate();
+  void Deallocate(void* block);
+
+  BlockPoolStats GetStats() const;
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next_;
+  };
+  struct Batch {
+    FreeBlock* head_;
+    std::size_t length_;
+  };
+  struct ThreadCache {
+    FreeBlock* head_ = nullptr;
+    // Read by GetStats().
+    OwnerCounter<std::size_t> length_;
+  };
+  struct RegisteredThreadCache : ThreadCache {
+    RegisteredThreadCache() {
+      BlockPool::Instance().Register(this);
+    }
+    ~RegisteredThreadCache() {
+      BlockPool::Instance().Unregister(this);
+      IsThreadFinished() = true;
+    }
+  };
+
+  BlockPool() = default;
+  ~BlockPool() = default;
+
+  static ThreadCache& LocalCache() {
+    thread_local RegisteredThreadCache cache;
+    return cache;
+  }
+  // Destructors of other thread_local objects can still use the pool
+  // after the cache of their thread is destroyed, then the blocks are
+  // taken from the global pool and returned to it one by one.
+  static bool& IsThreadFinished() {
+    thread_local bool finished = false;
+    return finished;
+  }
+
+  static void* TakeBlock(ThreadCache* cache) {
+    FreeBlock* block = cache->head_;
+    cache->head_ = block->next_;
+    cache->length_.Decrement();
+    return block;
+  }
+  // Returns the new length of the free list.
+  static std::size_t PutBlock(ThreadCache* cache, void* block) {
+    FreeBlock* free_block = static_cast<FreeBlock*>(block);
+    free_block->next_ = cache->head_;
+    cache->head_ = free_block;
+    return cache->length_.Increment();
+  }
+
+  void Register(ThreadCache* cache);
+  void Unregister(ThreadCache* cache);
+  // Gives the cache a batch from the global pool or a fresh page.
+  void Refill(ThreadCache* cache);
+  // Moves all blocks of the cache except the first `keep` ones
+  // to the global pool. The first ones were freed last, so they are
+  // more likely to be in the processor cache.
+  void GiveBack(ThreadCache* cache, std::size_t keep);
+
+  mutable std::mutex mutex_;
+  std::vector<Batch> batches_;
+  std::vector<void*> pages_;
+  std::vector<ThreadCache*> caches_;
+  std::size_t global_free_blocks_ = 0;
+};
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void* BlockPool<BlockSize, Alignment>::Allocate() {
+  if (IsThreadFinished()) {
+    ThreadCache cache;
+    Refill(&cache);
+    void* block = TakeBlock(&cache);
+    if (cache.head_ != nullptr) {
+      GiveBack(&cache, 0);
+    }
+    return block;
+  }
+  ThreadCache& cache = LocalCache();
+  if (cache.head_ == nullptr) {
+    Refill(&cache);
+  }
+  return TakeBlock(&cache);
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void BlockPool<BlockSize, Alignment>::Deallocate(void* block) {
+  if (block == nullptr) {
+    return;
+  }
+  if (IsThreadFinished()) {
+    ThreadCache cache;
+    PutBlock(&cache, block);
+    GiveBack(&cache, 0);
+    return;
+  }
+  ThreadCache& cache = LocalCache();
+  if (PutBlock(&cache, block) > 2 * kBatchSize) {
+    GiveBack(&cache, kBatchSize);
+  }
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+BlockPoolStats BlockPool<BlockSize, Alignment>::GetStats() const {
+  BlockPoolStats stats;
+  stats.block_size = kBlockSize;
+  stats.blocks_per_page = kBlocksPerPage;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.pages = pages_.size();
+  stats.global_free_blocks = global_free_blocks_;
+  std::size_t free_blocks = global_free_blocks_;
+  for (const ThreadCache* cache : caches_) {
+    std::size_t length = cache->length_.Load();
+    stats.thread_free_blocks.push_back(length);
+    free_blocks += length;
+  }
+  stats.live_blocks = pages_.size() * kBlocksPerPage - free_blocks;
+  return stats;
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void BlockPool<BlockSize, Alignment>::Register(ThreadCache* cache) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  caches_.push_back(cache);
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void BlockPool<BlockSize, Alignment>::Unregister(ThreadCache* cache) {
+  if (cache->head_ != nullptr) {
+    GiveBack(cache, 0);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  caches_.erase(std::find(caches_.begin(), caches_.end(), cache));
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void BlockPool<BlockSize, Alignment>::Refill(ThreadCache* cache) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (batches_.empty()) {
+    char* page = static_cast<char*>(::operator new(kPageSize));
+    pages_.push_back(page);
+    for (std::size_t first = 0; first < kBlocksPerPage; first += kBatchSize) {
+      std::size_t length = std::min(kBatchSize, kBlocksPerPage - first);
+      FreeBlock* head = nullptr;
+      for (std::size_t i = first + length; i > first; --i) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(
+            page + (i - 1) * kBlockSize);
+        block->next_ = head;
+        head = block;
+      }
+      batches_.push_back(Batch{head, length});
+      global_free_blocks_ += length;
+    }
+  }
+  Batch batch = batches_.back();
+  batches_.pop_back();
+  global_free_blocks_ -= batch.length_;
+  cache->head_ = batch.head_;
+  cache->length_.Store(batch.length_);
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+void BlockPool<BlockSize, Alignment>::GiveBack(ThreadCache* cache,
+                                               std::size_t keep) {
+  std::size_t length = cache->length_.Load();
+  assert(keep < length);
+  FreeBlock* head = cache->head_;
+  if (keep == 0) {
+    cache->head_ = nullptr;
+  } else {
+    FreeBlock* last_kept = cache->head_;
+    for (std::size_t i = 1; i < keep; ++i) {
+      last_kept = last_kept->next_;
+    }
+    head = last_kept->next_;
+    last_kept->next_ = nullptr;
+  }
+  cache->length_.Store(keep);
+  std::lock_guard<std::mutex> lock(mutex_);
+  batches_.push_back(Batch{head, length - keep});
+  global_free_blocks_ += length - keep;
+}
+
+// Allocator of single objects that takes them from BlockPool.
+// Objects that are too big or too aligned for the pages (e.g. managers
+// with big deleters) are taken from ::operator new instead.
+template<typename T>
+class BlockPoolAllocator {
+ public:
+  using value_type = T;
+
+  BlockPoolAllocator() = default;
+  template<typename U>
+  BlockPoolAllocator(const BlockPoolAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    assert(n == 1);
+    if constexpr (IsPooled()) {
+      return static_cast<T*>(
+          BlockPool<sizeof(T), alignof(T)>::Instance().Allocate());
+    } else {
+      return static_cast<T*>(
+          ::operator new(sizeof(T), std::align_val_t(alignof(T))));
+    }
+  }
+  void deallocate(T* ptr, std::size_t) {
+    if constexpr (IsPooled()) {
+      BlockPool<sizeof(T), alignof(T)>::Instance().Deallocate(ptr);
+    } else {
+      ::operator delete(ptr, std::align_val_t(alignof(T)));
+    }
+  }
+
+  template<typename U>
+  bool operator==(const BlockPoolAllocator<U>&) const {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const BlockPoolAllocator<U>&) const {
+    return false;
+  }
+
+ private:
+  // Not a constant, as the allocator can be a member of an incomplete T.
+  static constexpr bool IsPooled() {
+    return sizeof(T) <= kMaxPooledBlockSize && alignof(T) <= kPageAlignment;
+  }
+};
+
+}  // namespace pointers
+
+#endif  // BLOCK_POOL_H_
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "block_pool.h"
+#include "shared_ptr.h"
+#include "weak_ptr.h"
+
+using pointers::BlockPool;
+using pointers::BlockPoolStats;
+
+namespace {
+
+std::size_t ThreadFreeBlocks(const BlockPoolStats& stats) {
+  return std::accumulate(stats.thread_free_blocks.begin(),
+                         stats.thread_free_blocks.end(), std::size_t{0});
+}
+
+}  // namespace
+
+TEST(Test_0, AllocateAndDeallocate) {
+  using Pool = BlockPool<24, 8>;
+  EXPECT_EQ(Pool::kBlockSize, 24);
+  void* block_1 = Pool::Instance().Allocate();
+  void* block_2 = Pool::Instance().Allocate();
+  EXPECT_NE(block_1, block_2);
+  BlockPoolStats stats = Pool::Instance().GetStats();
+  EXPECT_EQ(stats.pages, 1);
+  EXPECT_EQ(stats.live_blocks, 2);
+  EXPECT_EQ(stats.global_free_blocks + ThreadFreeBlocks(stats),
+            stats.blocks_per_page - 2);
+  Pool::Instance().Deallocate(block_2);
+  EXPECT_EQ(Pool::Instance().Allocate(), block_2);
+  Pool::Instance().Deallocate(block_1);
+  Pool::Instance().Deallocate(block_2);
+  EXPECT_EQ(Pool::Instance().GetStats().live_blocks, 0);
+}
+
+TEST(Test_1, PagesAreReused) {
+  using Pool = BlockPool<40, 8>;
+  std::vector<void*> blocks;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 5000; ++i) {
+      blocks.push_back(Pool::Instance().Allocate());
+    }
+    for (void* block : blocks) {
+      Pool::Instance().Deallocate(block);
+    }
+    blocks.clear();
+  }
+  BlockPoolStats stats = Pool::Instance().GetStats();
+  EXPECT_EQ(stats.live_blocks, 0);
+  EXPECT_EQ(stats.pages, (5000 + stats.blocks_per_page - 1) /
+                             stats.blocks_per_page);
+  EXPECT_LE(ThreadFreeBlocks(stats), 2 * Pool::kBatchSize);
+}
+
+TEST(Test_2, BlocksMoveBetweenThreads) {
+  using Pool = BlockPool<32, 16>;
+  std::vector<std::vector<void*>> blocks(8);
+  std::vector<std::thread> threads;
+  for (auto& thread_blocks : blocks) {
+    threads.emplace_back([&thread_blocks]() {
+      for (int i = 0; i < 1000; ++i) {
+        thread_blocks.push_back(Pool::Instance().Allocate());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  EXPECT_EQ(Pool::Instance().GetStats().live_blocks, 8000);
+  // Every thread frees the blocks allocated by another one.
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&blocks, i]() {
+      for (void* block : blocks[(i + 1) % 8]) {
+        Pool::Instance().Deallocate(block);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BlockPoolStats stats = Pool::Instance().GetStats();
+  EXPECT_EQ(stats.live_blocks, 0);
+  EXPECT_EQ(stats.global_free_blocks + ThreadFreeBlocks(stats),
+            stats.pages * stats.blocks_per_page);
+}
+
+TEST(Test_3, SharedPtrManagers) {
+  std::size_t live_before =
+      pointers::GetCounterManagerPoolStats().live_blocks;
+  {
+    pointers::SharedPtr<int> sptr_1(new int(1));
+    pointers::SharedPtr<double> sptr_2(new double(2));
+    EXPECT_EQ(pointers::GetCounterManagerPoolStats().live_blocks,
+              live_before + 2);
+    pointers::WeakPtr<int> wptr(sptr_1);
+    sptr_1.Reset();
+    EXPECT_EQ(pointers::GetCounterManagerPoolStats().live_blocks,
+              live_before + 2);
+    wptr.Reset();
+    EXPECT_EQ(pointers::GetCounterManagerPoolStats().live_blocks,
+              live_before + 1);
+  }
+  EXPECT_EQ(pointers::GetCounterManagerPoolStats().live_blocks, live_before);
+}
+
+TEST(Test_4, BigDeleters) {
+  struct BigDeleter {
+    void operator()(int* ptr) const {
+      delete ptr;
+    }
+    char state[4096] = {};
+  };
+  std::size_t live_before =
+      pointers::GetCounterManagerPoolStats().live_blocks;
+  {
+    // The manager doesn't fit a page, so it is taken from the heap.
+    pointers::SharedPtr<int> sptr(new int(1), BigDeleter());
+    EXPECT_EQ(*sptr, 1);
+    EXPECT_EQ(pointers::GetCounterManagerPoolStats().live_blocks,
+              live_before);
+  }
+}
@@ -0,0 +1,305 @@
+#ifndef COMPACT_SHARED_PTR_H_
+#define COMPACT_SHARED_PTR_H_
+
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+#include "shared_ptr.h"
+
+namespace pointers {
+
+// CompactSharedPtr and CompactWeakPtr keep only a pointer to the manager,
+// which stores the address of the object, so they take 8 bytes instead
+// of 16. The price is one more memory access in operator-> and Get(),
+// and there are no converting and aliasing constructors, because the
+// address can't differ from the one in the manager.
+// Good for big containers of handles, that are iterated more often
+// than dereferenced.
+
+template<typename T, typename CountingPolicy>
+class CompactCounterManager : public CounterManager<CountingPolicy> {
+ public:
+  T* GetObject() const {
+    return object_;
+  }
+
+ protected:
+  explicit CompactCounterManager(T* object) : object_(object) {}
+
+ private:
+  T* object_;
+};
+
+// Manager of an object allocated by the user, taken from BlockPool.
+template<typename T, typename CountingPolicy,
+         typename Deleter = DefaultDelete<T>>
+class CompactPointerManager : public CompactCounterManager<T, CountingPolicy>,
+                              private CompressedStorage<0, Deleter> {
+ public:
+  using ManagerAllocator = BlockPoolAllocator<CompactPointerManager>;
+
+  static CompactPointerManager* Create(T* ptr, Deleter deleter) {
+    ManagerAllocator allocator;
+    CompactPointerManager* manager;
+    try {
+      manager = allocator.allocate(1);
+    } catch (...) {
+      deleter(ptr);
+      throw;
+    }
+    new (manager) CompactPointerManager(ptr, std::move(deleter));
+    POINTERS_RECORD_REFCOUNT_EVENT(kObjectCreated);
+    return manager;
+  }
+
+ protected:
+  void DeleteObject() override {
+    CompressedStorage<0, Deleter>::GetStored()(this->GetObject());
+  }
+  void DeleteManager() override {
+    ManagerAllocator allocator;
+    this->~CompactPointerManager();
+    allocator.deallocate(this, 1);
+  }
+
+ private:
+  CompactPointerManager(T* ptr, Deleter deleter)
+      : CompactCounterManager<T, CountingPolicy>(ptr),
+        CompressedStorage<0, Deleter>(std::move(deleter)) {}
+};
+
+// Manager that keeps the object inside itself.
+template<typename T, typename CountingPolicy>
+class CompactObjectManager : public CompactCounterManager<T, CountingPolicy> {
+ public:
+  using ManagerAllocator = std::allocator<CompactObjectManager>;
+
+  template<typename... Args>
+  static CompactObjectManager* Create(Args&&... args) {
+    ManagerAllocator allocator;
+    CompactObjectManager* manager = allocator.allocate(1);
+    try {
+      new (manager) CompactObjectManager(std::forward<Args>(args)...);
+    } catch (...) {
+      allocator.deallocate(manager, 1);
+      throw;
+    }
+    POINTERS_RECORD_REFCOUNT_EVENT(kObjectCreated);
+    return manager;
+  }
+
+ protected:
+  void DeleteObject() override {
+    this->GetObject()->~T();
+  }
+  void DeleteManager() override {
+    ManagerAllocator allocator;
+    this->~CompactObjectManager();
+    allocator.deallocate(this, 1);
+  }
+
+ private:
+  // The object is created after the base, which only remembers its address.
+  template<typename... Args>
+  explicit CompactObjectManager(Args&&... args)
+      : CompactCounterManager<T, CountingPolicy>(
+            reinterpret_cast<T*>(&storage_)) {
+    new (&storage_) T(std::forward<Args>(args)...);
+  }
+
+  alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+class CompactWeakPtr;
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+class CompactSharedPtr {
+ public:
+  template<typename U, typename Policy>
+  friend class CompactWeakPtr;
+  template<typename U, typename Policy, typename... Args>
+  friend CompactSharedPtr<U, Policy> MakeCompactShared(Args&&... args);
+  using Manager = CompactCounterManager<T, CountingPolicy>;
+
+  // CONSTRUCTORS
+  CompactSharedPtr() = default;
+  explicit CompactSharedPtr(T* ptr)
+      : CompactSharedPtr(ptr, DefaultDelete<T>()) {}
+  template<typename Deleter>
+  CompactSharedPtr(T* ptr, Deleter deleter) {
+    if (ptr != nullptr) {
+      manager_ = CompactPointerManager<T, CountingPolicy, Deleter>::Create(
+          ptr, std::move(deleter));
+    }
+  }
+  CompactSharedPtr(const CompactSharedPtr& other_pointer)
+      : manager_(other_pointer.manager_) {
+    if (manager_ != nullptr) {
+      manager_->AddShared();
+    }
+  }
+  CompactSharedPtr(CompactSharedPtr&& other_pointer) noexcept
+      : manager_(other_pointer.manager_) {
+    other_pointer.manager_ = nullptr;
+  }
+
+  // DELETING OPERATORS
+  ~CompactSharedPtr() {
+    Reset();
+  }
+  void Reset() {
+    if (manager_ != nullptr) {
+      manager_->ReleaseShared();
+      manager_ = nullptr;
+    }
+  }
+
+  // ASSIGMENT OPERATORS
+  CompactSharedPtr& operator=(const CompactSharedPtr& rhs) {
+    CompactSharedPtr(rhs).Swap(*this);
+    return *this;
+  }
+  CompactSharedPtr& operator=(CompactSharedPtr&& rhs) noexcept {
+    CompactSharedPtr(std::move(rhs)).Swap(*this);
+    return *this;
+  }
+  void Swap(CompactSharedPtr& other) noexcept {
+    std::swap(manager_, other.manager_);
+  }
+
+  // GETTERS
+  int GetCounter() const {
+    return (manager_ != nullptr) ? manager_->GetSharedCounter() : 0;
+  }
+  T* Get() const {
+    return (manager_ != nullptr) ? manager_->GetObject() : nullptr;
+  }
+  T& operator*() const {
+    assert(manager_ != nullptr);
+    return *manager_->GetObject();
+  }
+  T* operator->() const {
+    assert(manager_ != nullptr);
+    return manager_->GetObject();
+  }
+
+  // COMPARING OPERATORS
+  bool operator==(const CompactSharedPtr& rhs) const {
+    return manager_ == rhs.manager_;
+  }
+  bool operator!=(const CompactSharedPtr& rhs) const {
+    return manager_ != rhs.manager_;
+  }
+  bool operator==(const T* rhs) const {
+    return Get() == rhs;
+  }
+  bool operator!=(const T* rhs) const {
+    return Get() != rhs;
+  }
+
+ private:
+  struct AdoptTag {};
+
+  // Takes the reference that the manager was created with.
+  CompactSharedPtr(AdoptTag, Manager* manager) : manager_(manager) {}
+
+  Manager* manager_ = nullptr;
+};
+
+template<typename T, typename CountingPolicy>
+class CompactWeakPtr {
+ public:
+  using Manager = CompactCounterManager<T, CountingPolicy>;
+
+  // CONSTRUCTORS
+  CompactWeakPtr() = default;
+  explicit CompactWeakPtr(const CompactSharedPtr<T, CountingPolicy>& ptr)
+      : manager_(ptr.manager_) {
+    if (manager_ != nullptr) {
+      manager_->AddWeak();
+    }
+  }
+  CompactWeakPtr(const CompactWeakPtr& other_pointer)
+      : manager_(other_pointer.manager_) {
+    if (manager_ != nullptr) {
+      manager_->AddWeak();
+    }
+  }
+  CompactWeakPtr(CompactWeakPtr&& other_pointer) noexcept
+      : manager_(other_pointer.manager_) {
+    other_pointer.manager_ = nullptr;
+  }
+
+  // DELETING OPERATORS
+  ~CompactWeakPtr() {
+    Reset();
+  }
+  void Reset() {
+    if (manager_ != nullptr) {
+      manager_->ReleaseWeak();
+      manager_ = nullptr;
+    }
+  }
+
+  // ASSIGMENT OPERATORS
+  CompactWeakPtr& operator=(const CompactWeakPtr& rhs) {
+    CompactWeakPtr(rhs).Swap(*this);
+    return *this;
+  }
+  CompactWeakPtr& operator=(CompactWeakPtr&& rhs) noexcept {
+    CompactWeakPtr(std::move(rhs)).Swap(*this);
+    return *this;
+  }
+  void Swap(CompactWeakPtr& other) noexcept {
+    std::swap(manager_, other.manager_);
+  }
+
+  // INNER POINTER PROCESSING
+  bool Expired() const {
+    return manager_ == nullptr || manager_->GetSharedCounter() == 0;
+  }
+  // Returns empty pointer if the object is already destroyed.
+  CompactSharedPtr<T, CountingPolicy> Lock() const {
+    if (manager_ == nullptr || !manager_->TryAddShared()) {
+      POINTERS_RECORD_REFCOUNT_EVENT(kLockFailure);
+      return CompactSharedPtr<T, CountingPolicy>();
+    }
+    POINTERS_RECORD_REFCOUNT_EVENT(kLockSuccess);
+    using Pointer = CompactSharedPtr<T, CountingPolicy>;
+    return Pointer(typename Pointer::AdoptTag(), manager_);
+  }
+
+  int GetNumberOfConnectedShared() const {
+    return (manager_ != nullptr) ? manager_->GetSharedCounter() : 0;
+  }
+
+ private:
+  Manager* manager_ = nullptr;
+};
+
+// Thread-safe versions.
+template<typename T>
+using ConcurrentCompactSharedPtr = CompactSharedPtr<T, AtomicCounting>;
+template<typename T>
+using ConcurrentCompactWeakPtr = CompactWeakPtr<T, AtomicCounting>;
+
+// Creates the object and its manager in one allocation.
+template<typename T, typename CountingPolicy = SingleThreadedCounting,
+         typename... Args>
+CompactSharedPtr<T, CountingPolicy> MakeCompactShared(Args&&... args) {
+  using Pointer = CompactSharedPtr<T, CountingPolicy>;
+  return Pointer(typename Pointer::AdoptTag(),
+                 CompactObjectManager<T, CountingPolicy>::Create(
+                     std::forward<Args>(args)...));
+}
+
+static_assert(sizeof(CompactSharedPtr<int>) == sizeof(void*),
+              "CompactSharedPtr must be a single pointer");
+static_assert(sizeof(CompactWeakPtr<int>) == sizeof(void*),
+              "CompactWeakPtr must be a single pointer");
+
+}  // namespace pointers
+
+#endif  // COMPACT_SHARED_PTR_H_
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "compact_shared_ptr.h"
+
+using pointers::CompactSharedPtr;
+using pointers::SharedPtr;
+
+namespace {
+
+struct Schema {
+  explicit Schema(int id) : id(id) {}
+  int id;
+};
+
+template<typename Pointer>
+Pointer MakeHandle(int id);
+
+template<>
+SharedPtr<Schema> MakeHandle<SharedPtr<Schema>>(int id) {
+  return pointers::MakeShared<Schema>(id);
+}
+
+template<>
+CompactSharedPtr<Schema> MakeHandle<CompactSharedPtr<Schema>>(int id) {
+  return pointers::MakeCompactShared<Schema>(id);
+}
+
+// Every object is referenced by several handles, like in an index.
+template<typename Pointer>
+std::vector<Pointer> MakeHandles(int count) {
+  constexpr int kHandlesPerObject = 8;
+  std::vector<Pointer> objects;
+  for (int i = 0; i < count / kHandlesPerObject; ++i) {
+    objects.push_back(MakeHandle<Pointer>(i));
+  }
+  std::vector<Pointer> handles;
+  handles.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    handles.push_back(objects[i % objects.size()]);
+  }
+  return handles;
+}
+
+template<typename Pointer>
+void SetMemoryCounters(benchmark::State& state, std::size_t count) {
+  state.counters["bytes_per_handle"] = sizeof(Pointer);
+  state.counters["vector_bytes"] =
+      static_cast<double>(count * sizeof(Pointer));
+}
+
+// Walks over the handles without touching the objects,
+// e.g. looking for a particular one.
+template<typename Pointer>
+void BM_FindHandle(benchmark::State& state) {
+  std::vector<Pointer> handles = MakeHandles<Pointer>(state.range(0));
+  Pointer missing = MakeHandle<Pointer>(-1);
+  for (auto _ : state) {
+    int found = 0;
+    for (const Pointer& handle : handles) {
+      found += (handle == missing);
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * handles.size());
+  SetMemoryCounters<Pointer>(state, handles.size());
+}
+
+// Copying of the whole container, which also touches every counter.
+template<typename Pointer>
+void BM_CopyHandles(benchmark::State& state) {
+  std::vector<Pointer> handles = MakeHandles<Pointer>(state.range(0));
+  for (auto _ : state) {
+    std::vector<Pointer> copy = handles;
+    benchmark::DoNotOptimize(copy.data());
+  }
+  state.SetItemsProcessed(state.iterations() * handles.size());
+  SetMemoryCounters<Pointer>(state, handles.size());
+}
+
+// Dereferencing of every handle: the compact one has to load
+// the address of the object from the manager first.
+template<typename Pointer>
+void BM_Dereference(benchmark::State& state) {
+  std::vector<Pointer> handles = MakeHandles<Pointer>(state.range(0));
+  for (auto _ : state) {
+    long long sum = 0;
+    for (const Pointer& handle : handles) {
+      sum += handle->id;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * handles.size());
+  SetMemoryCounters<Pointer>(state, handles.size());
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_FindHandle, SharedPtr<Schema>)->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_FindHandle, CompactSharedPtr<Schema>)
+    ->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_CopyHandles, SharedPtr<Schema>)->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_CopyHandles, CompactSharedPtr<Schema>)
+    ->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Dereference, SharedPtr<Schema>)->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Dereference, CompactSharedPtr<Schema>)
+    ->Range(1 << 12, 1 << 22);
+
+BENCHMARK_MAIN();
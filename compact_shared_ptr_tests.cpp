@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "compact_shared_ptr.h"
+
+using pointers::CompactSharedPtr;
+using pointers::CompactWeakPtr;
+using pointers::MakeCompactShared;
+
+namespace {
+
+struct Counted {
+  Counted(int value, int* destroyed) : value(value), destroyed_(destroyed) {}
+  ~Counted() {
+    (*destroyed_)++;
+  }
+  int value;
+  int* destroyed_;
+};
+
+}  // namespace
+
+TEST(Test_0, Size) {
+  EXPECT_EQ(sizeof(CompactSharedPtr<std::string>), sizeof(void*));
+  EXPECT_EQ(sizeof(CompactWeakPtr<std::string>), sizeof(void*));
+  EXPECT_EQ(sizeof(pointers::ConcurrentCompactSharedPtr<int>), sizeof(void*));
+}
+
+TEST(Test_1, Ownership) {
+  int destroyed = 0;
+  {
+    CompactSharedPtr<Counted> sptr_1(new Counted(1, &destroyed));
+    CompactSharedPtr<Counted> sptr_2 = sptr_1;
+    EXPECT_EQ(sptr_1.GetCounter(), 2);
+    EXPECT_EQ(sptr_2->value, 1);
+    EXPECT_TRUE(sptr_1 == sptr_2);
+    CompactSharedPtr<Counted> sptr_3 = std::move(sptr_2);
+    EXPECT_TRUE(sptr_2.Get() == nullptr);
+    EXPECT_EQ(sptr_3.GetCounter(), 2);
+    sptr_1.Reset();
+    EXPECT_EQ(destroyed, 0);
+    sptr_1 = MakeCompactShared<Counted>(2, &destroyed);
+    EXPECT_EQ((*sptr_1).value, 2);
+    sptr_3 = sptr_1;
+    EXPECT_EQ(destroyed, 1);
+  }
+  EXPECT_EQ(destroyed, 2);
+  CompactSharedPtr<int> empty(nullptr);
+  EXPECT_EQ(empty.GetCounter(), 0);
+}
+
+TEST(Test_2, CustomDeleter) {
+  int deleted = 0;
+  {
+    CompactSharedPtr<int> sptr(new int(5), [&deleted](int* ptr) {
+      ++deleted;
+      delete ptr;
+    });
+    CompactSharedPtr<int> copy = sptr;
+  }
+  EXPECT_EQ(deleted, 1);
+}
+
+TEST(Test_3, WeakPointers) {
+  int destroyed = 0;
+  CompactWeakPtr<Counted> wptr;
+  {
+    CompactSharedPtr<Counted> sptr = MakeCompactShared<Counted>(3, &destroyed);
+    wptr = CompactWeakPtr<Counted>(sptr);
+    EXPECT_FALSE(wptr.Expired());
+    EXPECT_EQ(wptr.Lock()->value, 3);
+    EXPECT_EQ(wptr.GetNumberOfConnectedShared(), 1);
+  }
+  EXPECT_EQ(destroyed, 1);
+  EXPECT_TRUE(wptr.Expired());
+  EXPECT_TRUE(wptr.Lock().Get() == nullptr);
+}
+
+TEST(Test_4, ConcurrentCopying) {
+  pointers::ConcurrentCompactSharedPtr<int> sptr =
+      MakeCompactShared<int, pointers::AtomicCounting>(7);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([sptr]() {
+      for (int j = 0; j < 1000; ++j) {
+        pointers::ConcurrentCompactSharedPtr<int> copy = sptr;
+        EXPECT_EQ(*copy, 7);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(sptr.GetCounter(), 1);
+}
+
+TEST(Test_5, ThrowingConstructor) {
+  struct Throwing {
+    Throwing() {
+      throw std::runtime_error("Throwing");
+    }
+  };
+  // The memory of the manager is freed, which is checked by ASan.
+  EXPECT_THROW(MakeCompactShared<Throwing>(), std::runtime_error);
+}
@@ -0,0 +1,299 @@
+#ifndef CONCURRENT_DEQUE_H_
+#define CONCURRENT_DEQUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace containers {
+
+// Deque for several producers and consumers, e.g. a work queue:
+//   ConcurrentDeque<Task> tasks;
+//   tasks.PushBack(task);                        // producers
+//   while (std::optional<Task> task = tasks.PopFront()) { ... }  // workers
+//   tasks.Close();                               // stops the workers
+// Every end has its own lock, so operations at different ends don't wait
+// for each other. They touch different nodes while the deque keeps
+// enough values (3 for pops, 2 for pushes), which is checked with the
+// atomic size; otherwise the operation takes both locks.
+// A popped node is unlinked under the lock of its end and can't be seen
+// by other threads anymore, so it is destroyed after the lock is released.
+// Nodes are allocated and freed by several threads at once, so Allocator
+// must be thread-safe (NodePoolAllocator is not).
+template<typename T, typename Allocator = std::allocator<T>>
+class ConcurrentDeque {
+ public:
+  ConcurrentDeque() : ConcurrentDeque(Allocator()) {}
+  explicit ConcurrentDeque(const Allocator& allocator);
+  ConcurrentDeque(const ConcurrentDeque&) = delete;
+  ConcurrentDeque& operator=(const ConcurrentDeque&) = delete;
+  // Must not be called concurrently with other methods.
+  ~ConcurrentDeque();
+
+  void PushFront(T value) {
+    Push(true, std::move(value));
+  }
+  void PushBack(T value) {
+    Push(false, std::move(value));
+  }
+
+  // Return nullopt if the deque is empty.
+  std::optional<T> TryPopFront() {
+    return TryPop(true);
+  }
+  std::optional<T> TryPopBack() {
+    return TryPop(false);
+  }
+  // Wait for a value, return nullopt if the deque is empty and closed.
+  std::optional<T> PopFront() {
+    return Pop(true);
+  }
+  std::optional<T> PopBack() {
+    return Pop(false);
+  }
+
+  // Wakes up the threads waiting in PopFront() and PopBack(). Values can
+  // still be pushed and popped, but the pops don't wait anymore.
+  void Close();
+  bool IsClosed() const {
+    return closed_.load();
+  }
+
+  // Pushes in progress are not counted.
+  std::size_t Size() const {
+    return size_.load();
+  }
+
+ private:
+  struct NodeBase {
+    NodeBase* prev_;
+    NodeBase* next_;
+  };
+
+  struct Node : NodeBase {
+    explicit Node(T&& passed_value) : value(std::move(passed_value)) {}
+    T value;
+  };
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  // The lock and the sentinel node of an end, on their own cache line.
+  struct alignas(64) Side {
+    std::mutex mutex;
+    NodeBase sentinel;
+  };
+
+  // Smallest sizes at which an operation can take the lock of its end
+  // only (see the comment of the class).
+  static constexpr std::size_t kMinSizeForPop = 3;
+  static constexpr std::size_t kMinSizeForPush = 2;
+
+  void Push(bool at_front, T value);
+  std::optional<T> TryPop(bool at_front);
+  std::optional<T> Pop(bool at_front);
+
+  // Must be called under the lock of the end.
+  void Link(bool at_front, Node* node);
+  Node* Unlink(bool at_front);
+  std::optional<T> TakeValue(Node* node);
+
+  Node* CreateNode(T&& value);
+  void DestroyNode(Node* node);
+  void NotifyIfWaiting();
+
+  Side& GetSide(bool at_front) {
+    return at_front ? front_ : back_;
+  }
+
+  Side front_;
+  Side back_;
+  alignas(64) std::atomic<std::size_t> size_{0};
+  std::atomic<bool> closed_{false};
+  // Threads waiting in Pop(), so that pushes don't lock wait_mutex_
+  // when nobody waits.
+  std::atomic<int> waiters_{0};
+  std::mutex wait_mutex_;
+  std::condition_variable not_empty_;
+  NodeAllocator allocator_;
+};
+
+template<typename T, typename Allocator>
+ConcurrentDeque<T, Allocator>::ConcurrentDeque(const Allocator& allocator)
+    : allocator_(allocator) {
+  front_.sentinel.prev_ = nullptr;
+  front_.sentinel.next_ = &back_.sentinel;
+  back_.sentinel.prev_ = &front_.sentinel;
+  back_.sentinel.next_ = nullptr;
+}
+
+template<typename T, typename Allocator>
+ConcurrentDeque<T, Allocator>::~ConcurrentDeque() {
+  NodeBase* node = front_.sentinel.next_;
+  while (node != &back_.sentinel) {
+    NodeBase* next = node->next_;
+    DestroyNode(static_cast<Node*>(node));
+    node = next;
+  }
+}
+
+template<typename T, typename Allocator>
+void ConcurrentDeque<T, Allocator>::Close() {
+  closed_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+  }
+  not_empty_.notify_all();
+}
+
+template<typename T, typename Allocator>
+void ConcurrentDeque<T, Allocator>::Push(bool at_front, T value) {
+  Node* node = CreateNode(std::move(value));
+  {
+    std::unique_lock<std::mutex> lock(GetSide(at_front).mutex);
+    if (size_.load() >= kMinSizeForPush) {
+      Link(at_front, node);
+      size_.fetch_add(1);
+    } else {
+      lock.unlock();
+      std::scoped_lock both_locks(front_.mutex, back_.mutex);
+      Link(at_front, node);
+      size_.fetch_add(1);
+    }
+  }
+  NotifyIfWaiting();
+}
+
+template<typename T, typename Allocator>
+std::optional<T> ConcurrentDeque<T, Allocator>::TryPop(bool at_front) {
+  Node* node = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(GetSide(at_front).mutex);
+    // The value is taken from the size before the node is unlinked, so
+    // the other end sees the size without it and can't come close.
+    std::size_t size = size_.load();
+    while (size >= kMinSizeForPop &&
+           !size_.compare_exchange_weak(size, size - 1)) {
+    }
+    if (size >= kMinSizeForPop) {
+      node = Unlink(at_front);
+    } else {
+      lock.unlock();
+      std::scoped_lock both_locks(front_.mutex, back_.mutex);
+      if (size_.load() == 0) {
+        return std::nullopt;
+      }
+      size_.fetch_sub(1);
+      node = Unlink(at_front);
+    }
+  }
+  return TakeValue(node);
+}
+
+template<typename T, typename Allocator>
+std::optional<T> ConcurrentDeque<T, Allocator>::Pop(bool at_front) {
+  while (true) {
+    std::optional<T> value = TryPop(at_front);
+    if (value.has_value()) {
+      return value;
+    }
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    // The counter is increased before the size is checked, and pushes
+    // check it after increasing the size, so no push is missed.
+    waiters_.fetch_add(1);
+    not_empty_.wait(lock, [this]() {
+      return size_.load() > 0 || closed_.load();
+    });
+    waiters_.fetch_sub(1);
+    if (size_.load() == 0 && closed_.load()) {
+      return std::nullopt;
+    }
+  }
+}
+
+template<typename T, typename Allocator>
+void ConcurrentDeque<T, Allocator>::Link(bool at_front, Node* node) {
+  if (at_front) {
+    NodeBase* first = front_.sentinel.next_;
+    node->prev_ = &front_.sentinel;
+    node->next_ = first;
+    first->prev_ = node;
+    front_.sentinel.next_ = node;
+  } else {
+    NodeBase* last = back_.sentinel.prev_;
+    node->prev_ = last;
+    node->next_ = &back_.sentinel;
+    last->next_ = node;
+    back_.sentinel.prev_ = node;
+  }
+}
+
+template<typename T, typename Allocator>
+typename ConcurrentDeque<T, Allocator>::Node*
+    ConcurrentDeque<T, Allocator>::Unlink(bool at_front) {
+  NodeBase* node;
+  if (at_front) {
+    node = front_.sentinel.next_;
+    front_.sentinel.next_ = node->next_;
+    node->next_->prev_ = &front_.sentinel;
+  } else {
+    node = back_.sentinel.prev_;
+    back_.sentinel.prev_ = node->prev_;
+    node->prev_->next_ = &back_.sentinel;
+  }
+  assert(node != &front_.sentinel && node != &back_.sentinel);
+  return static_cast<Node*>(node);
+}
+
+template<typename T, typename Allocator>
+std::optional<T> ConcurrentDeque<T, Allocator>::TakeValue(Node* node) {
+  std::optional<T> value;
+  try {
+    value.emplace(std::move(node->value));
+  } catch (...) {
+    DestroyNode(node);
+    throw;
+  }
+  DestroyNode(node);
+  return value;
+}
+
+template<typename T, typename Allocator>
+typename ConcurrentDeque<T, Allocator>::Node*
+    ConcurrentDeque<T, Allocator>::CreateNode(T&& value) {
+  Node* node = NodeTraits::allocate(allocator_, 1);
+  try {
+    new (node) Node(std::move(value));
+  } catch (...) {
+    NodeTraits::deallocate(allocator_, node, 1);
+    throw;
+  }
+  return node;
+}
+
+template<typename T, typename Allocator>
+void ConcurrentDeque<T, Allocator>::DestroyNode(Node* node) {
+  node->~Node();
+  NodeTraits::deallocate(allocator_, node, 1);
+}
+
+template<typename T, typename Allocator>
+void ConcurrentDeque<T, Allocator>::NotifyIfWaiting() {
+  if (waiters_.load() > 0) {
+    {
+      std::lock_guard<std::mutex> lock(wait_mutex_);
+    }
+    not_empty_.notify_one();
+  }
+}
+
+}  // namespace containers
+
+#endif  // CONCURRENT_DEQUE_H_
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <optional>
+#include "bidirectional_list.h"
+#include "concurrent_deque.h"
+
+// Compares ConcurrentDeque with BiDirectionalList behind one mutex, used
+// as a work queue. Half of the threads push to the back and the other
+// half pop from the front; a single thread does both.
+
+using containers::BiDirectionalList;
+using containers::ConcurrentDeque;
+
+namespace {
+
+class LockedList {
+ public:
+  void PushBack(int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    list_.PushBack(value);
+  }
+  std::optional<int> TryPopFront() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (list_.IsEmpty()) {
+      return std::nullopt;
+    }
+    int value = list_.Front()->value;
+    list_.PopFront();
+    return value;
+  }
+
+ private:
+  std::mutex mutex_;
+  BiDirectionalList<int> list_;
+};
+
+// Values pushed before the start, so that consumers rarely find the queue
+// empty.
+constexpr int kPrefill = 1024;
+
+template<typename Queue>
+void BM_WorkQueue(benchmark::State& state) {
+  static Queue* queue = nullptr;
+  if (state.thread_index() == 0) {
+    queue = new Queue();
+    for (int i = 0; i < kPrefill; ++i) {
+      queue->PushBack(i);
+    }
+  }
+  bool single = (state.threads() == 1);
+  bool producer = (state.thread_index() % 2 == 0);
+  int value = 0;
+  for (auto _ : state) {
+    if (single || producer) {
+      queue->PushBack(++value);
+    }
+    if (single || !producer) {
+      benchmark::DoNotOptimize(queue->TryPopFront());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete queue;
+    queue = nullptr;
+  }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_WorkQueue, LockedList)->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WorkQueue, ConcurrentDeque<int>)->ThreadRange(1, 32)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "concurrent_deque.h"
+
+using containers::ConcurrentDeque;
+
+TEST(Test_0, BothEnds) {
+  ConcurrentDeque<int> deque;
+  EXPECT_FALSE(deque.TryPopFront().has_value());
+  EXPECT_FALSE(deque.TryPopBack().has_value());
+  for (int i = 0; i < 5; ++i) {
+    deque.PushBack(i);
+    deque.PushFront(-i);
+  }
+  EXPECT_EQ(deque.Size(), 10u);
+  EXPECT_EQ(deque.TryPopFront(), -4);
+  EXPECT_EQ(deque.TryPopBack(), 4);
+  EXPECT_EQ(deque.PopFront(), -3);
+  EXPECT_EQ(deque.PopBack(), 3);
+  for (int expected : {-2, -1, 0, 0, 1}) {
+    EXPECT_EQ(deque.TryPopFront(), expected);
+  }
+  EXPECT_EQ(deque.TryPopBack(), 2);
+  EXPECT_FALSE(deque.TryPopBack().has_value());
+  EXPECT_EQ(deque.Size(), 0u);
+}
+
+TEST(Test_1, MoveOnlyValues) {
+  ConcurrentDeque<std::unique_ptr<int>> deque;
+  deque.PushBack(std::make_unique<int>(1));
+  deque.PushBack(std::make_unique<int>(2));
+  deque.PushFront(std::make_unique<int>(0));
+  std::optional<std::unique_ptr<int>> value = deque.TryPopBack();
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(**value, 2);
+  // The rest is destroyed with the deque.
+}
+
+TEST(Test_2, ProducersAndConsumers) {
+  const int kProducers = 4;
+  const int kConsumers = 4;
+  const int kValues = 20000;
+  ConcurrentDeque<int> deque;
+  std::atomic<long long> sum{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kConsumers; ++i) {
+    consumers.emplace_back([&deque, &sum, &popped, i]() {
+      while (std::optional<int> value =
+                 (i % 2 == 0) ? deque.PopFront() : deque.PopBack()) {
+        sum += *value;
+        ++popped;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.emplace_back([&deque, i]() {
+      for (int value = i; value < kValues; value += kProducers) {
+        if (value % 2 == 0) {
+          deque.PushBack(value);
+        } else {
+          deque.PushFront(value);
+        }
+      }
+    });
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  deque.Close();
+  for (std::thread& consumer : consumers) {
+    consumer.join();
+  }
+  EXPECT_EQ(popped.load(), kValues);
+  EXPECT_EQ(sum.load(), 1LL * kValues * (kValues - 1) / 2);
+  EXPECT_EQ(deque.Size(), 0u);
+}
+
+// The deque stays small, so both locks are taken often.
+TEST(Test_3, SmallDeque) {
+  ConcurrentDeque<int> deque;
+  std::atomic<int> pushed{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < 20000; ++j) {
+        if ((i + j) % 2 == 0) {
+          (i < 2) ? deque.PushFront(j) : deque.PushBack(j);
+          ++pushed;
+        } else {
+          std::optional<int> value =
+              (i % 2 == 0) ? deque.TryPopBack() : deque.TryPopFront();
+          if (value.has_value()) {
+            ++popped;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  int left = 0;
+  while (deque.TryPopFront().has_value()) {
+    ++left;
+  }
+  EXPECT_EQ(popped.load() + left, pushed.load());
+}
+
+TEST(Test_4, Closing) {
+  ConcurrentDeque<int> deque;
+  std::thread consumer([&deque]() {
+    EXPECT_EQ(deque.PopBack(), 7);
+    EXPECT_FALSE(deque.PopBack().has_value());
+  });
+  deque.PushFront(7);
+  while (deque.Size() != 0) {
+    std::this_thread::yield();
+  }
+  deque.Close();
+  consumer.join();
+  EXPECT_TRUE(deque.IsClosed());
+  deque.PushBack(8);
+  EXPECT_EQ(deque.PopFront(), 8);
+  EXPECT_FALSE(deque.PopFront().has_value());
+}
@@ -0,0 +1,259 @@
+#ifndef DEFERRED_RECLAMATION_H_
+#define DEFERRED_RECLAMATION_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "shared_ptr.h"
+
+namespace pointers {
+
+struct ReclamationStats {
+  std::size_t depth = 0;
+  std::size_t peak_depth = 0;
+  std::uint64_t enqueued = 0;
+  std::uint64_t reclaimed = 0;
+  // Objects destroyed by the releasing thread, because the queue was full.
+  std::uint64_t reclaimed_inline = 0;
+  // Releases that had to wait for free space in the queue.
+  std::uint64_t backpressure_waits = 0;
+  // Time from enqueuing of an object to the end of its destruction.
+  std::chrono::nanoseconds total_latency{0};
+  std::chrono::nanoseconds max_latency{0};
+};
+
+// Objects, the last SharedPtr to which is released on a latency-critical
+// thread, can be destroyed later by a background thread or by Drain().
+// SharedPtr-s are created with DeferredDelete (or MakeDeferredShared),
+// the usual ones are not affected:
+//   pointers::ReclamationQueue::Options options;
+//   options.background_thread = true;
+//   pointers::ReclamationQueue queue(options);
+//   auto graph = pointers::MakeDeferredShared<Graph>(queue, ...);
+// The object is enqueued when its counter drops to zero, so WeakPtr-s
+// see it as expired from that moment, although it is not destroyed yet.
+// The queue never holds more than `capacity` objects. When it is full,
+// the releasing thread waits for the background thread, or destroys the
+// object itself if there is no background thread (or the releasing thread
+// is reclaiming other objects at the moment).
+class ReclamationQueue {
+ public:
+  enum class OverflowPolicy {
+    kWait,
+    kReclaimInline,
+  };
+
+  struct Options {
+    std::size_t capacity = 1024;
+    OverflowPolicy overflow = OverflowPolicy::kWait;
+    bool background_thread = false;
+  };
+
+  ReclamationQueue() : ReclamationQueue(Options()) {}
+  explicit ReclamationQueue(Options options);
+  ReclamationQueue(const ReclamationQueue&) = delete;
+  ReclamationQueue& operator=(const ReclamationQueue&) = delete;
+  // Stops the background thread and destroys everything left.
+  // Pointers using the queue must not outlive it.
+  ~ReclamationQueue();
+
+  template<typename T>
+  void Push(T* object) {
+    Push(object, [](void* ptr) {
+      delete static_cast<T*>(ptr);
+    });
+  }
+  void Push(void* object, void (*destroy)(void*));
+
+  // Destroys the queued objects, including the ones released by their
+  // destructors. Returns the number of destroyed objects.
+  std::size_t Drain();
+
+  ReclamationStats GetStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    void* object;
+    void (*destroy)(void*);
+    Clock::time_point enqueued;
+  };
+
+  // Set while the thread destroys objects of any queue, such thread
+  // must never wait for free space.
+  static bool& IsReclaiming() {
+    thread_local bool reclaiming = false;
+    return reclaiming;
+  }
+
+  // Takes everything from the ring buffer, mutex_ must be locked.
+  void TakeAll(std::vector<Entry>* entries);
+  std::size_t Reclaim(const std::vector<Entry>& entries);
+  void RunBackgroundThread();
+
+  const Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  // Ring buffer of `capacity` entries, allocated once.
+  std::vector<Entry> entries_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+  bool stopping_ = false;
+  ReclamationStats stats_;
+  std::thread background_thread_;
+};
+
+// Deleter that hands the object over to the queue.
+template<typename T>
+class DeferredDelete {
+ public:
+  explicit DeferredDelete(ReclamationQueue* queue) : queue_(queue) {}
+
+  void operator()(T* ptr) const {
+    queue_->Push(ptr);
+  }
+
+ private:
+  ReclamationQueue* queue_;
+};
+
+// MakeShared can't be used here: its object lives inside the manager,
+// which may be freed before the object is reclaimed.
+template<typename T, typename CountingPolicy = SingleThreadedCounting,
+         typename... Args>
+SharedPtr<T, CountingPolicy> MakeDeferredShared(ReclamationQueue& queue,
+                                                Args&&... args) {
+  return SharedPtr<T, CountingPolicy>(new T(std::forward<Args>(args)...),
+                                      DeferredDelete<T>(&queue));
+}
+
+inline ReclamationQueue::ReclamationQueue(Options options)
+    : options_(options), entries_(std::max<std::size_t>(options.capacity, 1)) {
+  if (options_.background_thread) {
+    background_thread_ = std::thread([this]() {
+      RunBackgroundThread();
+    });
+  }
+}
+
+inline ReclamationQueue::~ReclamationQueue() {
+  if (background_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    not_empty_.notify_one();
+    background_thread_.join();
+  }
+  Drain();
+}
+
+inline void ReclamationQueue::Push(void* object, void (*destroy)(void*)) {
+  Clock::time_point enqueued = Clock::now();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (size_ == entries_.size()) {
+      bool can_wait = options_.overflow == OverflowPolicy::kWait &&
+                      background_thread_.joinable() && !IsReclaiming();
+      if (can_wait) {
+        ++stats_.backpressure_waits;
+        not_full_.wait(lock, [this]() {
+          return size_ < entries_.size();
+        });
+      } else {
+        ++stats_.reclaimed_inline;
+        lock.unlock();
+        destroy(object);
+        return;
+      }
+    }
+    entries_[(head_ + size_) % entries_.size()] =
+        Entry{object, destroy, enqueued};
+    ++size_;
+    ++stats_.enqueued;
+    stats_.peak_depth = std::max(stats_.peak_depth, size_);
+  }
+  not_empty_.notify_one();
+}
+
+inline std::size_t ReclamationQueue::Drain() {
+  std::size_t reclaimed = 0;
+  std::vector<Entry> entries;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == 0) {
+        return reclaimed;
+      }
+      TakeAll(&entries);
+    }
+    not_full_.notify_all();
+    reclaimed += Reclaim(entries);
+  }
+}
+
+inline ReclamationStats ReclamationQueue::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ReclamationStats stats = stats_;
+  stats.depth = size_;
+  return stats;
+}
+
+inline void ReclamationQueue::TakeAll(std::vector<Entry>* entries) {
+  entries->clear();
+  for (std::size_t i = 0; i < size_; ++i) {
+    entries->push_back(entries_[(head_ + i) % entries_.size()]);
+  }
+  head_ = 0;
+  size_ = 0;
+}
+
+inline std::size_t ReclamationQueue::Reclaim(
+    const std::vector<Entry>& entries) {
+  bool was_reclaiming = IsReclaiming();
+  IsReclaiming() = true;
+  std::chrono::nanoseconds total_latency{0};
+  std::chrono::nanoseconds max_latency{0};
+  for (const Entry& entry : entries) {
+    entry.destroy(entry.object);
+    std::chrono::nanoseconds latency = Clock::now() - entry.enqueued;
+    total_latency += latency;
+    max_latency = std::max(max_latency, latency);
+  }
+  IsReclaiming() = was_reclaiming;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.reclaimed += entries.size();
+  stats_.total_latency += total_latency;
+  stats_.max_latency = std::max(stats_.max_latency, max_latency);
+  return entries.size();
+}
+
+inline void ReclamationQueue::RunBackgroundThread() {
+  std::vector<Entry> entries;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [this]() {
+        return size_ > 0 || stopping_;
+      });
+      if (size_ == 0) {
+        return;
+      }
+      TakeAll(&entries);
+    }
+    not_full_.notify_all();
+    Reclaim(entries);
+  }
+}
+
+}  // namespace pointers
+
+#endif  // DEFERRED_RECLAMATION_H_
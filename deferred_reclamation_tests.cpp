@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "deferred_reclamation.h"
+#include "weak_ptr.h"
+
+using pointers::MakeDeferredShared;
+using pointers::ReclamationQueue;
+using pointers::SharedPtr;
+using pointers::WeakPtr;
+
+namespace {
+
+struct Node {
+  explicit Node(std::atomic<int>* destroyed) : destroyed_(destroyed) {}
+  ~Node() {
+    destroyed_->fetch_add(1);
+  }
+  std::atomic<int>* destroyed_;
+  SharedPtr<Node> child;
+};
+
+}  // namespace
+
+TEST(Test_0, DrainDestroys) {
+  std::atomic<int> destroyed{0};
+  ReclamationQueue queue;
+  SharedPtr<Node> sptr = MakeDeferredShared<Node>(queue, &destroyed);
+  WeakPtr<Node> wptr(sptr);
+  sptr.Reset();
+  EXPECT_TRUE(wptr.Expired());
+  EXPECT_EQ(destroyed, 0);
+  EXPECT_EQ(queue.GetStats().depth, 1u);
+  EXPECT_EQ(queue.Drain(), 1u);
+  EXPECT_EQ(destroyed, 1);
+  pointers::ReclamationStats stats = queue.GetStats();
+  EXPECT_EQ(stats.depth, 0u);
+  EXPECT_EQ(stats.peak_depth, 1u);
+  EXPECT_EQ(stats.enqueued, 1u);
+  EXPECT_EQ(stats.reclaimed, 1u);
+  EXPECT_GE(stats.max_latency.count(), 0);
+}
+
+TEST(Test_1, Cascade) {
+  std::atomic<int> destroyed{0};
+  ReclamationQueue queue;
+  SharedPtr<Node> root = MakeDeferredShared<Node>(queue, &destroyed);
+  root->child = MakeDeferredShared<Node>(queue, &destroyed);
+  root->child->child = MakeDeferredShared<Node>(queue, &destroyed);
+  root.Reset();
+  EXPECT_EQ(destroyed, 0);
+  EXPECT_EQ(queue.Drain(), 3u);
+  EXPECT_EQ(destroyed, 3);
+}
+
+TEST(Test_2, InlineWhenFull) {
+  std::atomic<int> destroyed{0};
+  ReclamationQueue::Options options;
+  options.capacity = 2;
+  ReclamationQueue queue(options);
+  for (int i = 0; i < 3; ++i) {
+    MakeDeferredShared<Node>(queue, &destroyed);
+  }
+  EXPECT_EQ(destroyed, 1);
+  pointers::ReclamationStats stats = queue.GetStats();
+  EXPECT_EQ(stats.depth, 2u);
+  EXPECT_EQ(stats.reclaimed_inline, 1u);
+  queue.Drain();
+  EXPECT_EQ(destroyed, 3);
+}
+
+TEST(Test_3, BackgroundThread) {
+  std::atomic<int> destroyed{0};
+  {
+    ReclamationQueue::Options options;
+    options.capacity = 4;
+    options.background_thread = true;
+    ReclamationQueue queue(options);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&queue, &destroyed]() {
+        for (int j = 0; j < 1000; ++j) {
+          pointers::ConcurrentSharedPtr<Node> sptr =
+              MakeDeferredShared<Node, pointers::AtomicCounting>(queue,
+                                                                 &destroyed);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    pointers::ReclamationStats stats = queue.GetStats();
+    EXPECT_LE(stats.peak_depth, 4u);
+    EXPECT_EQ(stats.enqueued, 4000u);
+    EXPECT_EQ(stats.reclaimed_inline, 0u);
+  }
+  EXPECT_EQ(destroyed, 4000);
+}
+
+TEST(Test_4, DestructorDrains) {
+  std::atomic<int> destroyed{0};
+  {
+    ReclamationQueue queue;
+    MakeDeferredShared<Node>(queue, &destroyed);
+    EXPECT_EQ(destroyed, 0);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
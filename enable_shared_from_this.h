@@ -0,0 +1,50 @@
+#ifndef ENABLE_SHARED_FROM_THIS_H_
+#define ENABLE_SHARED_FROM_THIS_H_
+
+#include "shared_ptr.h"
+#include "weak_ptr.h"
+
+namespace pointers {
+
+// Base for objects that need a SharedPtr to themselves, e.g. for callbacks:
+//   class Connection : public pointers::EnableSharedFromThis<Connection> {
+//     void Start() { loop.Post(Callback{SharedFromThis()}); }
+//   };
+// The weak pointer inside is set by the first SharedPtr that owns the object
+// (SharedPtr(T*) or MakeShared), so SharedFromThis() reuses its manager
+// and allocates nothing. The policy must be the same as of that SharedPtr.
+template<typename T, typename CountingPolicy>
+class EnableSharedFromThis {
+ public:
+  using SharedFromThisType = T;
+
+  // Returns empty pointer if the object is not owned by any SharedPtr.
+  SharedPtr<T, CountingPolicy> SharedFromThis() {
+    return weak_this_.Lock();
+  }
+  SharedPtr<const T, CountingPolicy> SharedFromThis() const {
+    return SharedPtr<const T, CountingPolicy>(weak_this_.Lock());
+  }
+  WeakPtr<T, CountingPolicy> WeakFromThis() const {
+    return weak_this_;
+  }
+
+ protected:
+  EnableSharedFromThis() = default;
+  // Copy of the object has its own owners.
+  EnableSharedFromThis(const EnableSharedFromThis&) {}
+  EnableSharedFromThis& operator=(const EnableSharedFromThis&) {
+    return *this;
+  }
+  ~EnableSharedFromThis() = default;
+
+ private:
+  template<typename U, typename Policy>
+  friend class SharedPtr;
+
+  mutable WeakPtr<T, CountingPolicy> weak_this_;
+};
+
+}  // namespace pointers
+
+#endif  // ENABLE_SHARED_FROM_THIS_H_
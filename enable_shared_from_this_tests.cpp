@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include <vector>
+#include "enable_shared_from_this.h"
+
+using pointers::EnableSharedFromThis;
+using pointers::SharedPtr;
+using pointers::WeakPtr;
+
+namespace {
+
+class Connection : public EnableSharedFromThis<Connection> {
+ public:
+  explicit Connection(int* destroyed) : destroyed_(destroyed) {}
+  ~Connection() {
+    (*destroyed_)++;
+  }
+
+  std::function<int()> MakeCallback() {
+    SharedPtr<Connection> self = SharedFromThis();
+    return [self]() {
+      return self.GetCounter();
+    };
+  }
+
+ private:
+  int* destroyed_;
+};
+
+class SecureConnection : public Connection {
+ public:
+  using Connection::Connection;
+};
+
+}  // namespace
+
+TEST(Test_0, SharedFromThis) {
+  int destroyed = 0;
+  {
+    SharedPtr<Connection> sptr(new Connection(&destroyed));
+    SharedPtr<Connection> self = sptr->SharedFromThis();
+    EXPECT_TRUE(self == sptr);
+    EXPECT_EQ(sptr.GetCounter(), 2);
+    self.Reset();
+    std::function<int()> callback = sptr->MakeCallback();
+    sptr.Reset();
+    EXPECT_EQ(destroyed, 0);
+    EXPECT_EQ(callback(), 1);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_1, MakeShared) {
+  int destroyed = 0;
+  {
+    SharedPtr<Connection> sptr =
+        pointers::MakeShared<Connection>(&destroyed);
+    WeakPtr<Connection> weak = sptr->WeakFromThis();
+    EXPECT_EQ(weak.GetNumberOfConnectedShared(), 1);
+    const Connection& connection = *sptr;
+    SharedPtr<const Connection> const_self = connection.SharedFromThis();
+    EXPECT_EQ(sptr.GetCounter(), 2);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_2, NotOwned) {
+  int destroyed = 0;
+  {
+    Connection connection(&destroyed);
+    EXPECT_TRUE(connection.SharedFromThis().Get() == nullptr);
+    EXPECT_TRUE(connection.WeakFromThis().Expired());
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_3, DerivedAndConst) {
+  int destroyed = 0;
+  {
+    SharedPtr<const SecureConnection> sptr(new SecureConnection(&destroyed));
+    SharedPtr<const Connection> self = sptr->SharedFromThis();
+    EXPECT_EQ(self.Get(), sptr.Get());
+    EXPECT_EQ(sptr.GetCounter(), 2);
+    // Copy of the object is not connected to the original owner.
+    Connection copy(*sptr);
+    EXPECT_TRUE(copy.WeakFromThis().Expired());
+  }
+  EXPECT_EQ(destroyed, 2);
+}
@@ -0,0 +1,354 @@
+#ifndef INTRUSIVE_PTR_H_
+#define INTRUSIVE_PTR_H_
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <utility>
+#include "shared_ptr.h"
+
+namespace pointers {
+
+// IntrusivePtr works with any type, for which these functions
+// can be found by argument-dependent lookup:
+//   void IntrusiveAddRef(const T* ptr);
+//   void IntrusiveRelease(const T* ptr);  // deletes the object at zero
+// RefCounted and RefCountedWithWeak define them for their descendants.
+// IntrusivePtr is just one pointer and needs no CounterManager.
+
+template<typename Derived, typename CountingPolicy>
+class IntrusiveWeakAnchor;
+
+// CRTP base, that embeds the counter into the object:
+//   class Message : public pointers::RefCounted<Message> {...};
+template<typename Derived, typename CountingPolicy = SingleThreadedCounting>
+class RefCounted {
+ public:
+  int GetRefCounter() const {
+    return CountingPolicy::Load(ref_counter_);
+  }
+
+  friend void IntrusiveAddRef(const RefCounted* ptr) {
+    CountingPolicy::Increment(ptr->ref_counter_);
+  }
+  friend void IntrusiveRelease(const RefCounted* ptr) {
+    if (CountingPolicy::Decrement(ptr->ref_counter_) == 0) {
+      delete static_cast<const Derived*>(ptr);
+    }
+  }
+
+ protected:
+  RefCounted() = default;
+  // Counter belongs to the object, not to its value.
+  RefCounted(const RefCounted&) {}
+  RefCounted& operator=(const RefCounted&) {
+    return *this;
+  }
+  ~RefCounted() = default;
+
+ private:
+  mutable typename CountingPolicy::Counter ref_counter_{0};
+};
+
+// Same as RefCounted, but also allows IntrusiveWeakPtr to the object.
+// The anchor for weak pointers is allocated only when the first
+// of them is created.
+template<typename Derived, typename CountingPolicy = SingleThreadedCounting>
+class RefCountedWithWeak {
+ public:
+  using WeakAnchor = IntrusiveWeakAnchor<Derived, CountingPolicy>;
+
+  int GetRefCounter() const {
+    return CountingPolicy::Load(ref_counter_);
+  }
+
+  friend void IntrusiveAddRef(const RefCountedWithWeak* ptr) {
+    CountingPolicy::Increment(ptr->ref_counter_);
+  }
+  friend void IntrusiveRelease(const RefCountedWithWeak* ptr) {
+    if (CountingPolicy::Decrement(ptr->ref_counter_) == 0) {
+      WeakAnchor* anchor = ptr->anchor_.load(std::memory_order_acquire);
+      if (anchor != nullptr) {
+        anchor->Detach();
+      }
+      delete static_cast<const Derived*>(ptr);
+    }
+  }
+  friend WeakAnchor* IntrusiveGetWeakAnchor(const RefCountedWithWeak* ptr) {
+    return ptr->GetAnchor();
+  }
+
+ protected:
+  RefCountedWithWeak() = default;
+  RefCountedWithWeak(const RefCountedWithWeak&) {}
+  RefCountedWithWeak& operator=(const RefCountedWithWeak&) {
+    return *this;
+  }
+  ~RefCountedWithWeak() = default;
+
+ private:
+  friend class IntrusiveWeakAnchor<Derived, CountingPolicy>;
+
+  // Returns the anchor with a new reference to it.
+  WeakAnchor* GetAnchor() const;
+
+  mutable typename CountingPolicy::Counter ref_counter_{0};
+  mutable std::atomic<WeakAnchor*> anchor_{nullptr};
+};
+
+// Lives while there are weak pointers or the object itself.
+// Lock() and the destruction of the object are serialized by the mutex,
+// so Lock() never touches the counter of an already deleted object.
+template<typename Derived, typename CountingPolicy>
+class IntrusiveWeakAnchor {
+ public:
+  explicit IntrusiveWeakAnchor(const Derived* object) : object_(object) {}
+
+  // Returns nullptr if the object is already destroyed,
+  // otherwise the object with a new reference to it.
+  Derived* Lock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (object_ == nullptr ||
+        !CountingPolicy::IncrementIfNonZero(
+            static_cast<const RefCountedWithWeak<Derived, CountingPolicy>*>(
+                object_)->ref_counter_)) {
+      return nullptr;
+    }
+    return const_cast<Derived*>(object_);
+  }
+  bool Expired() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return object_ == nullptr ||
+           static_cast<const RefCountedWithWeak<Derived, CountingPolicy>*>(
+               object_)->GetRefCounter() == 0;
+  }
+
+  void AddRef() {
+    CountingPolicy::Increment(refs_);
+  }
+  void Release() {
+    if (CountingPolicy::Decrement(refs_) == 0) {
+      delete this;
+    }
+  }
+
+  // Called by the object right before its destruction.
+  void Detach() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      object_ = nullptr;
+    }
+    Release();
+  }
+
+ private:
+  std::mutex mutex_;
+  const Derived* object_;
+  // Weak pointers and one more for the object itself.
+  typename CountingPolicy::Counter refs_{1};
+};
+
+template<typename Derived, typename CountingPolicy>
+typename RefCountedWithWeak<Derived, CountingPolicy>::WeakAnchor*
+    RefCountedWithWeak<Derived, CountingPolicy>::GetAnchor() const {
+  WeakAnchor* anchor = anchor_.load(std::memory_order_acquire);
+  if (anchor == nullptr) {
+    WeakAnchor* new_anchor =
+        new WeakAnchor(static_cast<const Derived*>(this));
+    if (anchor_.compare_exchange_strong(anchor, new_anchor,
+                                        std::memory_order_acq_rel)) {
+      anchor = new_anchor;
+    } else {
+      delete new_anchor;
+    }
+  }
+  anchor->AddRef();
+  return anchor;
+}
+
+template<typename T>
+class IntrusivePtr {
+ public:
+  template<typename U>
+  friend class IntrusivePtr;
+
+  // CONSTRUCTORS
+  IntrusivePtr() = default;
+  // If `add_ref` is false, the pointer takes the reference
+  // that was already added to the object.
+  explicit IntrusivePtr(T* ptr, bool add_ref = true) : inner_pointer_(ptr) {
+    if (inner_pointer_ != nullptr && add_ref) {
+      IntrusiveAddRef(inner_pointer_);
+    }
+  }
+  IntrusivePtr(const IntrusivePtr& other_pointer)
+      : IntrusivePtr(other_pointer.inner_pointer_) {}
+  IntrusivePtr(IntrusivePtr&& other_pointer) noexcept
+      : inner_pointer_(other_pointer.Detach()) {}
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  IntrusivePtr(const IntrusivePtr<U>& other_pointer)
+      : IntrusivePtr(other_pointer.inner_pointer_) {}
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  IntrusivePtr(IntrusivePtr<U>&& other_pointer) noexcept
+      : inner_pointer_(other_pointer.Detach()) {}
+
+  // DELETING OPERATORS
+  ~IntrusivePtr() {
+    Reset();
+  }
+  void Reset() {
+    if (inner_pointer_ != nullptr) {
+      IntrusiveRelease(inner_pointer_);
+      inner_pointer_ = nullptr;
+    }
+  }
+  // Gives up the reference without releasing it.
+  T* Detach() {
+    T* ptr = inner_pointer_;
+    inner_pointer_ = nullptr;
+    return ptr;
+  }
+
+  // ASSIGMENT OPERATORS
+  IntrusivePtr& operator=(const IntrusivePtr& rhs) {
+    IntrusivePtr(rhs).Swap(*this);
+    return *this;
+  }
+  IntrusivePtr& operator=(IntrusivePtr&& rhs) noexcept {
+    IntrusivePtr(std::move(rhs)).Swap(*this);
+    return *this;
+  }
+  void Swap(IntrusivePtr& other) noexcept {
+    std::swap(inner_pointer_, other.inner_pointer_);
+  }
+
+  // GETTERS
+  T* Get() const {
+    return inner_pointer_;
+  }
+  T& operator*() const {
+    assert(inner_pointer_ != nullptr);
+    return *inner_pointer_;
+  }
+  T* operator->() const {
+    return inner_pointer_;
+  }
+
+  // COMPARING OPERATORS
+  bool operator==(const IntrusivePtr& rhs) const {
+    return inner_pointer_ == rhs.inner_pointer_;
+  }
+  bool operator!=(const IntrusivePtr& rhs) const {
+    return inner_pointer_ != rhs.inner_pointer_;
+  }
+  bool operator==(const T* rhs) const {
+    return inner_pointer_ == rhs;
+  }
+  bool operator!=(const T* rhs) const {
+    return inner_pointer_ != rhs;
+  }
+
+ private:
+  T* inner_pointer_{nullptr};
+};
+
+// Weak pointer for types derived from RefCountedWithWeak.
+// It keeps only the anchor, so it is one pointer as well.
+template<typename T>
+class IntrusiveWeakPtr {
+ public:
+  using WeakAnchor = typename T::WeakAnchor;
+
+  // CONSTRUCTORS
+  IntrusiveWeakPtr() = default;
+  explicit IntrusiveWeakPtr(const IntrusivePtr<T>& ptr) {
+    if (ptr.Get() != nullptr) {
+      anchor_ = IntrusiveGetWeakAnchor(ptr.Get());
+    }
+  }
+  IntrusiveWeakPtr(const IntrusiveWeakPtr& other_pointer)
+      : anchor_(other_pointer.anchor_) {
+    if (anchor_ != nullptr) {
+      anchor_->AddRef();
+    }
+  }
+  IntrusiveWeakPtr(IntrusiveWeakPtr&& other_pointer) noexcept
+      : anchor_(other_pointer.anchor_) {
+    other_pointer.anchor_ = nullptr;
+  }
+
+  // DELETING OPERATORS
+  ~IntrusiveWeakPtr() {
+    Reset();
+  }
+  void Reset() {
+    if (anchor_ != nullptr) {
+      anchor_->Release();
+      anchor_ = nullptr;
+    }
+  }
+
+  // ASSIGMENT OPERATORS
+  IntrusiveWeakPtr& operator=(const IntrusiveWeakPtr& rhs) {
+    IntrusiveWeakPtr(rhs).Swap(*this);
+    return *this;
+  }
+  IntrusiveWeakPtr& operator=(IntrusiveWeakPtr&& rhs) noexcept {
+    IntrusiveWeakPtr(std::move(rhs)).Swap(*this);
+    return *this;
+  }
+  void Swap(IntrusiveWeakPtr& other) noexcept {
+    std::swap(anchor_, other.anchor_);
+  }
+
+  // INNER POINTER PROCESSING
+  bool Expired() const {
+    return anchor_ == nullptr || anchor_->Expired();
+  }
+  // Returns empty pointer if the object is already destroyed.
+  IntrusivePtr<T> Lock() const {
+    if (anchor_ == nullptr) {
+      return IntrusivePtr<T>();
+    }
+    return IntrusivePtr<T>(static_cast<T*>(anchor_->Lock()), false);
+  }
+
+ private:
+  WeakAnchor* anchor_ = nullptr;
+};
+
+// FACTORIES AND CONVERSIONS
+
+template<typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// Deleter, with which SharedPtr releases its reference to
+// an intrusively counted object instead of deleting it.
+template<typename T>
+struct IntrusiveReleaser {
+  void operator()(T* ptr) const {
+    IntrusiveRelease(ptr);
+  }
+};
+
+// SharedPtr that holds one intrusive reference to the object, so both kinds
+// of pointers can be used together while the code is being migrated.
+template<typename CountingPolicy = SingleThreadedCounting, typename T>
+SharedPtr<T, CountingPolicy> ToSharedPtr(IntrusivePtr<T> ptr) {
+  return SharedPtr<T, CountingPolicy>(ptr.Detach(), IntrusiveReleaser<T>());
+}
+
+// Objects that are owned through SharedPtr made by ToSharedPtr
+// can be turned back into IntrusivePtr.
+template<typename T, typename CountingPolicy>
+IntrusivePtr<T> ToIntrusivePtr(const SharedPtr<T, CountingPolicy>& ptr) {
+  return IntrusivePtr<T>(const_cast<T*>(ptr.Get()));
+}
+
+}  // namespace pointers
+
+#endif  // INTRUSIVE_PTR_H_
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "intrusive_ptr.h"
+
+using pointers::IntrusivePtr;
+using pointers::IntrusiveWeakPtr;
+using pointers::MakeIntrusive;
+
+namespace {
+
+struct Message : pointers::RefCounted<Message> {
+  Message(int id, int* destroyed) : id(id), destroyed_(destroyed) {}
+  ~Message() {
+    (*destroyed_)++;
+  }
+  int id;
+  int* destroyed_;
+};
+
+struct Session : pointers::RefCountedWithWeak<Session,
+                                              pointers::AtomicCounting> {
+  explicit Session(int id) : id(id) {}
+  int id;
+};
+
+// Type with its own counter, that uses the hooks directly.
+struct Legacy {
+  int refs = 0;
+  bool* deleted;
+};
+
+void IntrusiveAddRef(const Legacy* ptr) {
+  const_cast<Legacy*>(ptr)->refs++;
+}
+
+void IntrusiveRelease(const Legacy* ptr) {
+  if (--const_cast<Legacy*>(ptr)->refs == 0) {
+    *ptr->deleted = true;
+    delete ptr;
+  }
+}
+
+}  // namespace
+
+TEST(Test_0, SizeAndCounting) {
+  EXPECT_EQ(sizeof(IntrusivePtr<Message>), sizeof(Message*));
+  EXPECT_EQ(sizeof(IntrusiveWeakPtr<Session>), sizeof(Session*));
+  int destroyed = 0;
+  {
+    IntrusivePtr<Message> ptr_1 = MakeIntrusive<Message>(7, &destroyed);
+    EXPECT_EQ(ptr_1->GetRefCounter(), 1);
+    IntrusivePtr<Message> ptr_2 = ptr_1;
+    EXPECT_EQ(ptr_1->GetRefCounter(), 2);
+    IntrusivePtr<Message> ptr_3(ptr_1.Get());
+    EXPECT_EQ(ptr_1->GetRefCounter(), 3);
+    IntrusivePtr<Message> ptr_4(std::move(ptr_3));
+    EXPECT_TRUE(ptr_3 == nullptr);
+    EXPECT_EQ(ptr_4->GetRefCounter(), 3);
+    ptr_2.Reset();
+    ptr_1 = ptr_4;
+    EXPECT_EQ((*ptr_1).id, 7);
+    EXPECT_EQ(ptr_1->GetRefCounter(), 2);
+    EXPECT_EQ(destroyed, 0);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_1, CustomHooks) {
+  bool deleted = false;
+  Legacy* legacy = new Legacy();
+  legacy->deleted = &deleted;
+  {
+    IntrusivePtr<Legacy> ptr_1(legacy);
+    IntrusivePtr<Legacy> ptr_2(ptr_1);
+    EXPECT_EQ(legacy->refs, 2);
+  }
+  EXPECT_TRUE(deleted);
+}
+
+TEST(Test_2, WeakPointers) {
+  IntrusiveWeakPtr<Session> weak;
+  EXPECT_TRUE(weak.Expired());
+  EXPECT_TRUE(weak.Lock() == nullptr);
+  {
+    IntrusivePtr<Session> session = MakeIntrusive<Session>(3);
+    weak = IntrusiveWeakPtr<Session>(session);
+    IntrusiveWeakPtr<Session> other_weak(weak);
+    EXPECT_FALSE(other_weak.Expired());
+    IntrusivePtr<Session> locked = other_weak.Lock();
+    EXPECT_TRUE(locked == session);
+    EXPECT_EQ(locked->GetRefCounter(), 2);
+  }
+  EXPECT_TRUE(weak.Expired());
+  EXPECT_TRUE(weak.Lock() == nullptr);
+}
+
+TEST(Test_3, ConcurrentLockAndRelease) {
+  for (int round = 0; round < 200; ++round) {
+    IntrusivePtr<Session> session = MakeIntrusive<Session>(round);
+    IntrusiveWeakPtr<Session> weak(session);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([weak, round]() {
+        for (int j = 0; j < 100; ++j) {
+          IntrusivePtr<Session> locked = weak.Lock();
+          if (locked != nullptr) {
+            EXPECT_EQ(locked->id, round);
+          }
+        }
+      });
+    }
+    session.Reset();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_TRUE(weak.Expired());
+  }
+}
+
+TEST(Test_4, SharedPtrInterop) {
+  int destroyed = 0;
+  IntrusivePtr<Message> intrusive = MakeIntrusive<Message>(1, &destroyed);
+  pointers::SharedPtr<Message> shared = pointers::ToSharedPtr(intrusive);
+  EXPECT_EQ(intrusive->GetRefCounter(), 2);
+  intrusive = pointers::ToIntrusivePtr(shared);
+  EXPECT_EQ(intrusive->GetRefCounter(), 2);
+  pointers::SharedPtr<Message> shared_copy = shared;
+  shared.Reset();
+  shared_copy.Reset();
+  EXPECT_EQ(destroyed, 0);
+  EXPECT_EQ(intrusive->GetRefCounter(), 1);
+  intrusive.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
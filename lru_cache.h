@@ -0,0 +1,351 @@
+#ifndef LRU_CACHE_H_
+#define LRU_CACHE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "bidirectional_list.h"
+#include "sharding.h"
+
+namespace containers {
+
+struct LruCacheStats {
+  std::size_t size = 0;
+  std::size_t bytes = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  // Entries removed to fit the limits.
+  std::uint64_t evictions = 0;
+};
+
+// Cache that evicts the least recently used entries when it exceeds
+// its limits:
+//   LruCache<std::string, Page>::Options options;
+//   options.max_entries = 1000;
+//   options.on_evict = [](const std::string& url, Page& page) { ... };
+//   LruCache<std::string, Page> pages(options);
+//   if (Page* page = pages.Get(url)) { ... }
+// Entries are kept in a PooledBiDirectionalList from the most recently
+// used one, and a hash table maps the keys (stored in the nodes) to the
+// nodes. A hit only moves its node to the front, and a node freed by an
+// eviction is reused by the next insertion, so hits allocate nothing.
+// Like the containers, the cache is not thread-safe, see ShardedLruCache.
+template<typename K, typename V, typename Hash = std::hash<K>,
+         typename KeyEqual = std::equal_to<K>>
+class LruCache {
+ public:
+  using EvictionCallback = std::function<void(const K&, V&)>;
+
+  struct Options {
+    // 0 means no limit.
+    std::size_t max_entries = 0;
+    std::size_t max_bytes = 0;
+    // Bigger entries are evicted at once, 0 means max_bytes. The newest
+    // entry is never evicted to fit the other limits, so with a bigger
+    // value one entry can exceed max_bytes.
+    std::size_t max_entry_bytes = 0;
+    // Is called for every evicted entry before it is destroyed, and must
+    // not use the cache. Erase() and Clear() don't call it.
+    EvictionCallback on_evict;
+  };
+
+  LruCache() : LruCache(Options()) {}
+  explicit LruCache(Options options) : options_(std::move(options)) {}
+  LruCache(const LruCache&) = delete;
+  LruCache& operator=(const LruCache&) = delete;
+  LruCache(LruCache&&) = default;
+  LruCache& operator=(LruCache&&) = default;
+
+  // Returns the value, which becomes the most recently used one, or
+  // nullptr. The pointer is valid until the entry is removed.
+  V* Get(const K& key);
+  // Inserts or replaces the value. `bytes` is the size of the entry for
+  // max_bytes, sizeof(K) + sizeof(V) by default. An entry bigger than
+  // max_entry_bytes is evicted at once, without evicting the others.
+  void Put(const K& key, V value) {
+    Put(key, std::move(value), kDefaultBytes);
+  }
+  void Put(const K& key, V value, std::size_t bytes);
+  // Returns false if there is no such key.
+  bool Erase(const K& key);
+  void Clear();
+
+  std::size_t Size() const {
+    return static_cast<std::size_t>(entries_.Size());
+  }
+  LruCacheStats GetStats() const;
+
+ private:
+  struct Entry {
+    K key;
+    V value;
+    std::size_t bytes;
+  };
+  using List = PooledBiDirectionalList<Entry>;
+  using Node = typename List::Node;
+
+  // The table keeps pointers to the keys in the nodes, like HashIndex.
+  struct KeyHash {
+    std::size_t operator()(const K* key) const {
+      return hash(*key);
+    }
+    Hash hash;
+  };
+  struct KeyEqualTo {
+    bool operator()(const K* lhs, const K* rhs) const {
+      return equal(*lhs, *rhs);
+    }
+    KeyEqual equal;
+  };
+  using Map = std::unordered_map<const K*, Node*, KeyHash, KeyEqualTo>;
+
+  static constexpr std::size_t kDefaultBytes = sizeof(K) + sizeof(V);
+
+  bool IsOverLimits() const;
+  void EvictToFit();
+
+  Options options_;
+  List entries_;
+  Map nodes_;
+  std::size_t bytes_ = 0;
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+  std::uint64_t evictions_ = 0;
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+V* LruCache<K, V, Hash, KeyEqual>::Get(const K& key) {
+  auto found = nodes_.find(&key);
+  if (found == nodes_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  Node* node = found->second;
+  entries_.MoveBefore(entries_.Front(), node);
+  return &node->value.value;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Put(const K& key, V value,
+                                         std::size_t bytes) {
+  std::size_t max_entry_bytes = (options_.max_entry_bytes != 0)
+                                    ? options_.max_entry_bytes
+                                    : options_.max_bytes;
+  if (max_entry_bytes != 0 && bytes > max_entry_bytes) {
+    // Otherwise it would evict all other entries before itself.
+    Erase(key);
+    ++evictions_;
+    if (options_.on_evict) {
+      options_.on_evict(key, value);
+    }
+    return;
+  }
+  auto found = nodes_.find(&key);
+  if (found != nodes_.end()) {
+    Node* node = found->second;
+    node->value.value = std::move(value);
+    bytes_ = bytes_ - node->value.bytes + bytes;
+    node->value.bytes = bytes;
+    entries_.MoveBefore(entries_.Front(), node);
+  } else {
+    entries_.PushFront(Entry{key, std::move(value), bytes});
+    Node* node = entries_.Front();
+    try {
+      nodes_.emplace(&node->value.key, node);
+    } catch (...) {
+      entries_.PopFront();
+      throw;
+    }
+    bytes_ += bytes;
+  }
+  EvictToFit();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Hash, KeyEqual>::Erase(const K& key) {
+  auto found = nodes_.find(&key);
+  if (found == nodes_.end()) {
+    return false;
+  }
+  Node* node = found->second;
+  bytes_ -= node->value.bytes;
+  nodes_.erase(found);
+  entries_.Erase(node);
+  return true;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Clear() {
+  nodes_.clear();
+  entries_.DeleteAll();
+  bytes_ = 0;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCacheStats LruCache<K, V, Hash, KeyEqual>::GetStats() const {
+  LruCacheStats stats;
+  stats.size = Size();
+  stats.bytes = bytes_;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  return stats;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Hash, KeyEqual>::IsOverLimits() const {
+  return (options_.max_entries != 0 && Size() > options_.max_entries) ||
+         (options_.max_bytes != 0 && bytes_ > options_.max_bytes);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::EvictToFit() {
+  while (entries_.Size() > 1 && IsOverLimits()) {
+    Node* node = entries_.Back();
+    // If the callback throws, the entry stays in the cache.
+    if (options_.on_evict) {
+      options_.on_evict(node->value.key, node->value.value);
+    }
+    nodes_.erase(&node->value.key);
+    bytes_ -= node->value.bytes;
+    ++evictions_;
+    entries_.PopBack();
+  }
+}
+
+// LruCache for several threads. Keys are spread over shards with their
+// own mutexes and LRU lists, so the least recently used entry is evicted
+// from the shard of the inserted key, not from the whole cache.
+// The limits of the options are divided between the shards (there are no
+// more shards than max_entries), and the eviction callback is called under
+// the lock of the shard. Entries are checked against the whole max_bytes,
+// so a shard can exceed its part of it by its newest entry.
+template<typename K, typename V, typename Hash = std::hash<K>,
+         typename KeyEqual = std::equal_to<K>>
+class ShardedLruCache {
+ public:
+  using Cache = LruCache<K, V, Hash, KeyEqual>;
+  using Options = typename Cache::Options;
+
+  explicit ShardedLruCache(const Options& options,
+                           std::size_t shard_count = 16);
+  ShardedLruCache(const ShardedLruCache&) = delete;
+  ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+
+  // Returns a copy of the value, as the entry may be evicted by another
+  // thread right after the lock is released.
+  std::optional<V> Get(const K& key);
+  void Put(const K& key, V value);
+  void Put(const K& key, V value, std::size_t bytes);
+  bool Erase(const K& key);
+  void Clear();
+
+  LruCacheStats GetStats() const;
+
+ private:
+  struct alignas(sharding::kShardAlignment) Shard {
+    mutable std::mutex mutex;
+    Cache cache;
+  };
+
+  // Part of `limit` for one of `count` shards, 0 means no limit.
+  static std::size_t GetShardLimit(std::size_t limit, std::size_t shard,
+                                   std::size_t count) {
+    if (limit == 0) {
+      return 0;
+    }
+    return std::max<std::size_t>(
+        1, limit / count + (shard < limit % count ? 1 : 0));
+  }
+
+  Shard& GetShard(const K& key) {
+    return shards_[sharding::ShardIndex(Hash()(key), shards_.size())];
+  }
+
+  std::vector<Shard> shards_;
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+ShardedLruCache<K, V, Hash, KeyEqual>::ShardedLruCache(
+    const Options& options, std::size_t shard_count)
+    : shards_(std::clamp<std::size_t>(
+          shard_count, 1,
+          options.max_entries == 0 ? SIZE_MAX : options.max_entries)) {
+  std::size_t count = shards_.size();
+  for (std::size_t i = 0; i < count; ++i) {
+    Options shard_options = options;
+    shard_options.max_entries = GetShardLimit(options.max_entries, i, count);
+    shard_options.max_bytes = GetShardLimit(options.max_bytes, i, count);
+    if (options.max_entry_bytes == 0) {
+      shard_options.max_entry_bytes = options.max_bytes;
+    }
+    shards_[i].cache = Cache(shard_options);
+  }
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+std::optional<V> ShardedLruCache<K, V, Hash, KeyEqual>::Get(const K& key) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  V* value = shard.cache.Get(key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  return *value;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void ShardedLruCache<K, V, Hash, KeyEqual>::Put(const K& key, V value) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.cache.Put(key, std::move(value));
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void ShardedLruCache<K, V, Hash, KeyEqual>::Put(const K& key, V value,
+                                                std::size_t bytes) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.cache.Put(key, std::move(value), bytes);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool ShardedLruCache<K, V, Hash, KeyEqual>::Erase(const K& key) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.Erase(key);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void ShardedLruCache<K, V, Hash, KeyEqual>::Clear() {
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.Clear();
+  }
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCacheStats ShardedLruCache<K, V, Hash, KeyEqual>::GetStats() const {
+  LruCacheStats stats;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    LruCacheStats shard_stats = shard.cache.GetStats();
+    stats.size += shard_stats.size;
+    stats.bytes += shard_stats.bytes;
+    stats.hits += shard_stats.hits;
+    stats.misses += shard_stats.misses;
+    stats.evictions += shard_stats.evictions;
+  }
+  return stats;
+}
+
+}  // namespace containers
+
+#endif  // LRU_CACHE_H_
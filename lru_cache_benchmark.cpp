@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include "lru_cache.h"
+
+// Compares LruCache with the usual std::list and std::unordered_map
+// pair, and ShardedLruCache with one LruCache under a mutex.
+
+using containers::LruCache;
+using containers::ShardedLruCache;
+
+namespace {
+
+constexpr std::size_t kCapacity = 1 << 14;
+
+// The cache that is usually written by hand.
+class StdLruCache {
+ public:
+  explicit StdLruCache(std::size_t capacity) : capacity_(capacity) {}
+
+  int* Get(std::uint64_t key) {
+    auto found = positions_.find(key);
+    if (found == positions_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return &found->second->second;
+  }
+  void Put(std::uint64_t key, int value) {
+    auto found = positions_.find(key);
+    if (found != positions_.end()) {
+      found->second->second = value;
+      entries_.splice(entries_.begin(), entries_, found->second);
+      return;
+    }
+    entries_.emplace_front(key, value);
+    positions_.emplace(key, entries_.begin());
+    if (entries_.size() > capacity_) {
+      positions_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+ private:
+  using List = std::list<std::pair<std::uint64_t, int>>;
+
+  std::size_t capacity_;
+  List entries_;
+  std::unordered_map<std::uint64_t, List::iterator> positions_;
+};
+
+LruCache<std::uint64_t, int> MakeCache() {
+  LruCache<std::uint64_t, int>::Options options;
+  options.max_entries = kCapacity;
+  return LruCache<std::uint64_t, int>(options);
+}
+
+// Keys of a simple random walk over `range` keys.
+std::uint64_t NextKey(std::uint64_t& state, std::uint64_t range) {
+  state = state * 6364136223846793005ull + 1442695040888963407ull;
+  return (state >> 33) % range;
+}
+
+// state.range(0) is the number of keys in percents of the capacity,
+// so 50 gives only hits, and 200 gives about half of misses.
+template<typename Cache>
+void RunGetOrPut(benchmark::State& state, Cache& cache) {
+  std::uint64_t range = kCapacity * state.range(0) / 100;
+  std::uint64_t random = 1;
+  for (auto _ : state) {
+    std::uint64_t key = NextKey(random, range);
+    int* value = cache.Get(key);
+    if (value == nullptr) {
+      cache.Put(key, static_cast<int>(key));
+    } else {
+      benchmark::DoNotOptimize(*value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_StdGetOrPut(benchmark::State& state) {
+  StdLruCache cache(kCapacity);
+  RunGetOrPut(state, cache);
+}
+
+void BM_GetOrPut(benchmark::State& state) {
+  LruCache<std::uint64_t, int> cache = MakeCache();
+  RunGetOrPut(state, cache);
+}
+
+// All threads use one cache, key ranges of the threads are different.
+template<typename Cache>
+void RunConcurrentGetOrPut(benchmark::State& state, Cache& cache) {
+  std::uint64_t random = state.thread_index() + 1;
+  for (auto _ : state) {
+    std::uint64_t key = NextKey(random, kCapacity);
+    std::optional<int> value = cache.Get(key);
+    if (!value.has_value()) {
+      cache.Put(key, static_cast<int>(key));
+    } else {
+      benchmark::DoNotOptimize(*value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+class LockedLruCache {
+ public:
+  std::optional<int> Get(std::uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int* value = cache_.Get(key);
+    return (value != nullptr) ? std::optional<int>(*value) : std::nullopt;
+  }
+  void Put(std::uint64_t key, int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.Put(key, value);
+  }
+
+ private:
+  std::mutex mutex_;
+  LruCache<std::uint64_t, int> cache_ = MakeCache();
+};
+
+void BM_LockedGetOrPut(benchmark::State& state) {
+  static LockedLruCache cache;
+  RunConcurrentGetOrPut(state, cache);
+}
+
+void BM_ShardedGetOrPut(benchmark::State& state) {
+  static ShardedLruCache<std::uint64_t, int> cache = []() {
+    ShardedLruCache<std::uint64_t, int>::Options options;
+    options.max_entries = kCapacity;
+    return ShardedLruCache<std::uint64_t, int>(options);
+  }();
+  RunConcurrentGetOrPut(state, cache);
+}
+
+}  // namespace
+
+BENCHMARK(BM_StdGetOrPut)->Arg(50)->Arg(200);
+BENCHMARK(BM_GetOrPut)->Arg(50)->Arg(200);
+BENCHMARK(BM_LockedGetOrPut)->ThreadRange(1, 8);
+BENCHMARK(BM_ShardedGetOrPut)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "lru_cache.h"
+
+using containers::LruCache;
+using containers::ShardedLruCache;
+
+TEST(Test_0, GetAndPut) {
+  LruCache<int, std::string>::Options options;
+  options.max_entries = 3;
+  LruCache<int, std::string> cache(options);
+  EXPECT_EQ(cache.Get(1), nullptr);
+  cache.Put(1, "one");
+  cache.Put(2, "two");
+  cache.Put(3, "three");
+  std::string* one = cache.Get(1);
+  ASSERT_NE(one, nullptr);
+  EXPECT_EQ(*one, "one");
+  // 2 is the least recently used one now.
+  cache.Put(4, "four");
+  EXPECT_EQ(cache.Get(2), nullptr);
+  EXPECT_EQ(cache.Size(), 3u);
+  // Hits relink the node, so the value stays where it was.
+  EXPECT_EQ(cache.Get(3), cache.Get(3));
+  EXPECT_EQ(cache.Get(1), one);
+  cache.Put(3, "THREE");
+  cache.Put(5, "five");
+  EXPECT_EQ(cache.Get(4), nullptr);
+  EXPECT_EQ(*cache.Get(3), "THREE");
+  containers::LruCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.size, 3u);
+  EXPECT_EQ(stats.hits, 5u);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_EQ(stats.evictions, 2u);
+}
+
+TEST(Test_1, CapacityInBytes) {
+  LruCache<std::string, std::string>::Options options;
+  options.max_bytes = 100;
+  LruCache<std::string, std::string> cache(options);
+  cache.Put("a", std::string(40, 'a'), 40);
+  cache.Put("b", std::string(40, 'b'), 40);
+  EXPECT_EQ(cache.GetStats().bytes, 80u);
+  cache.Put("c", std::string(30, 'c'), 30);
+  EXPECT_EQ(cache.Get("a"), nullptr);
+  EXPECT_EQ(cache.GetStats().bytes, 70u);
+  // Replacement changes the size of the entry.
+  cache.Put("b", std::string(60, 'b'), 60);
+  EXPECT_EQ(cache.GetStats().bytes, 90u);
+  EXPECT_EQ(cache.Size(), 2u);
+  cache.Put("d", std::string(200, 'd'), 200);
+  EXPECT_EQ(cache.Get("d"), nullptr);
+  EXPECT_EQ(cache.GetStats().evictions, 2u);
+  EXPECT_EQ(cache.GetStats().bytes, 90u);
+  EXPECT_TRUE(cache.Erase("c"));
+  EXPECT_FALSE(cache.Erase("c"));
+  EXPECT_EQ(cache.GetStats().bytes, 60u);
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0u);
+  EXPECT_EQ(cache.GetStats().bytes, 0u);
+}
+
+TEST(Test_2, EvictionCallback) {
+  std::vector<std::pair<int, int>> evicted;
+  LruCache<int, std::unique_ptr<int>>::Options options;
+  options.max_entries = 2;
+  options.on_evict = [&evicted](const int& key, std::unique_ptr<int>& value) {
+    evicted.emplace_back(key, *value);
+  };
+  LruCache<int, std::unique_ptr<int>> cache(options);
+  for (int i = 0; i < 5; ++i) {
+    cache.Put(i, std::make_unique<int>(i * 10));
+    cache.Get(0);
+  }
+  EXPECT_EQ(evicted, (std::vector<std::pair<int, int>>(
+                         {{1, 10}, {2, 20}, {3, 30}})));
+  cache.Erase(0);
+  cache.Clear();
+  EXPECT_EQ(evicted.size(), 3u);
+  EXPECT_EQ(cache.GetStats().evictions, 3u);
+}
+
+TEST(Test_3, Moving) {
+  LruCache<int, int>::Options options;
+  options.max_entries = 2;
+  LruCache<int, int> cache(options);
+  cache.Put(1, 10);
+  cache.Put(2, 20);
+  LruCache<int, int> moved = std::move(cache);
+  EXPECT_EQ(*moved.Get(1), 10);
+  moved.Put(3, 30);
+  EXPECT_EQ(moved.Get(2), nullptr);
+  EXPECT_EQ(moved.Size(), 2u);
+}
+
+TEST(Test_4, Sharded) {
+  ShardedLruCache<int, int>::Options options;
+  options.max_entries = 1024;
+  ShardedLruCache<int, int> cache(options, 8);
+  EXPECT_FALSE(cache.Get(1).has_value());
+  cache.Put(1, 10);
+  EXPECT_EQ(cache.Get(1), 10);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 10000; ++i) {
+        int key = (i * 7 + t) % 2000;
+        std::optional<int> value = cache.Get(key);
+        if (value.has_value()) {
+          EXPECT_EQ(*value, key * 10);
+        } else {
+          cache.Put(key, key * 10);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  containers::LruCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits + stats.misses, 40002u);
+  // Every shard holds at most 1024 / 8 entries.
+  EXPECT_LE(stats.size, 1024u);
+  EXPECT_GT(stats.evictions, 0u);
+  EXPECT_TRUE(cache.Erase(1) || !cache.Get(1).has_value());
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().size, 0u);
+}
+
+TEST(Test_5, ShardedLimits) {
+  ShardedLruCache<int, int>::Options options;
+  options.max_bytes = 1000;
+  ShardedLruCache<int, int> cache(options, 16);
+  // Bigger than the part of a shard, but not than the whole limit.
+  cache.Put(1, 10, 100);
+  EXPECT_EQ(cache.Get(1), 10);
+  cache.Put(2, 20, 2000);
+  EXPECT_FALSE(cache.Get(2).has_value());
+  EXPECT_EQ(cache.GetStats().bytes, 100u);
+  options.max_bytes = 0;
+  options.max_entries = 4;
+  // Only 4 shards are made, one entry each.
+  ShardedLruCache<int, int> small(options, 16);
+  for (int i = 0; i < 100; ++i) {
+    small.Put(i, i);
+  }
+  EXPECT_LE(small.GetStats().size, 4u);
+  EXPECT_GE(small.GetStats().evictions, 96u);
+}
@@ -0,0 +1,227 @@
+#ifndef NODE_POOL_H_
+#define NODE_POOL_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace containers {
+
+struct NodePoolStats {
+  // Zero until the first node is allocated.
+  std::size_t nodes_per_chunk = 0;
+  std::size_t chunks = 0;
+  std::size_t live_nodes = 0;
+};
+
+// Pool shared by all allocators rebound from one another. It doesn't
+// depend on the type of nodes, which is fixed by the first allocation.
+struct NodePoolFreeSlot {
+  NodePoolFreeSlot* next;
+};
+
+struct NodePoolState {
+  int users = 1;
+  std::size_t slot_size = 0;
+  // Alignment of the chunks and of the first slot in them.
+  std::size_t slot_alignment = 0;
+  std::size_t slots_per_chunk = 0;
+  // Chunks are linked through their first bytes.
+  void* chunks = nullptr;
+  std::size_t chunk_count = 0;
+  // Slots of the last chunk that were never given out.
+  std::size_t untouched = 0;
+  NodePoolFreeSlot* free_list = nullptr;
+  std::size_t live_nodes = 0;
+};
+
+// Allocator of container nodes. Nodes are cut from chunks of about 16 KB,
+// freed ones are kept in a free list and reused, and the chunks are
+// given back only when the pool is destroyed or by ReleaseAll().
+// Copies of the allocator (also rebound ones) share the pool, so lists
+// that exchange nodes can be created from one allocator. A copy of
+// a container gets a new pool (see select_on_container_copy_construction()),
+// so usually every container owns its nodes exclusively and can drop them
+// all at once. Like the containers, the pool is not thread-safe.
+// The pool serves one size of objects, the first one allocated from it.
+// Other sizes and arrays are taken from std::allocator.
+template<typename T>
+class NodePoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  template<typename U>
+  struct rebind {
+    using other = NodePoolAllocator<U>;
+  };
+
+  NodePoolAllocator() : pool_(new Pool()) {}
+  NodePoolAllocator(const NodePoolAllocator& other) noexcept
+      : NodePoolAllocator(other.pool_) {}
+  template<typename U>
+  NodePoolAllocator(const NodePoolAllocator<U>& other) noexcept
+      : NodePoolAllocator(other.pool_) {}
+  // Leaves `other` without a pool, it makes a new one when needed.
+  NodePoolAllocator(NodePoolAllocator&& other) noexcept
+      : pool_(other.pool_) {
+    other.pool_ = nullptr;
+  }
+  NodePoolAllocator& operator=(NodePoolAllocator rhs) noexcept {
+    std::swap(pool_, rhs.pool_);
+    return *this;
+  }
+  ~NodePoolAllocator() {
+    if (pool_ != nullptr && --pool_->users == 0) {
+      FreeChunks(pool_);
+      delete pool_;
+    }
+  }
+
+  NodePoolAllocator select_on_container_copy_construction() const {
+    return NodePoolAllocator();
+  }
+
+  T* allocate(std::size_t n);
+  void deallocate(T* ptr, std::size_t n);
+
+  // Frees all chunks at once, without destroying anything in them,
+  // if no other allocator shares the pool. Returns false otherwise.
+  bool ReleaseAll();
+
+  NodePoolStats GetStats() const;
+
+  template<typename U>
+  bool operator==(const NodePoolAllocator<U>& rhs) const {
+    return pool_ == rhs.pool_;
+  }
+  template<typename U>
+  bool operator!=(const NodePoolAllocator<U>& rhs) const {
+    return pool_ != rhs.pool_;
+  }
+
+ private:
+  template<typename U>
+  friend class NodePoolAllocator;
+
+  using FreeSlot = NodePoolFreeSlot;
+  using Pool = NodePoolState;
+
+  static constexpr std::size_t kChunkSize = 16 * 1024;
+  static constexpr std::size_t kSlotAlignment =
+      std::max(alignof(T), alignof(FreeSlot));
+  static constexpr std::size_t kSlotSize =
+      (std::max(sizeof(T), sizeof(FreeSlot)) + kSlotAlignment - 1) /
+      kSlotAlignment * kSlotAlignment;
+  // Slots start after the pointer to the next chunk.
+  static constexpr std::size_t kChunkHeader =
+      std::max(kSlotAlignment, sizeof(void*));
+
+  explicit NodePoolAllocator(Pool* pool) noexcept : pool_(pool) {
+    if (pool_ != nullptr) {
+      ++pool_->users;
+    }
+  }
+
+  static void FreeChunks(Pool* pool) {
+    while (pool->chunks != nullptr) {
+      void* next = *static_cast<void**>(pool->chunks);
+      ::operator delete(pool->chunks,
+                        std::align_val_t(pool->slot_alignment));
+      pool->chunks = next;
+    }
+  }
+
+  bool IsPooled(std::size_t n) const {
+    return n == 1 && pool_->slot_size == kSlotSize &&
+           pool_->slot_alignment == kSlotAlignment;
+  }
+
+  Pool* pool_;
+};
+
+template<typename T>
+T* NodePoolAllocator<T>::allocate(std::size_t n) {
+  if (pool_ == nullptr) {
+    pool_ = new Pool();
+  }
+  if (n == 1 && pool_->slot_size == 0) {
+    pool_->slot_size = kSlotSize;
+    pool_->slot_alignment = kSlotAlignment;
+    pool_->slots_per_chunk = std::max<std::size_t>(
+        1, (kChunkSize - kChunkHeader) / kSlotSize);
+  }
+  if (!IsPooled(n)) {
+    return std::allocator<T>().allocate(n);
+  }
+  void* slot;
+  if (pool_->free_list != nullptr) {
+    slot = pool_->free_list;
+    pool_->free_list = pool_->free_list->next;
+  } else {
+    if (pool_->untouched == 0) {
+      void* chunk = ::operator new(
+          kChunkHeader + pool_->slots_per_chunk * kSlotSize,
+          std::align_val_t(kSlotAlignment));
+      *static_cast<void**>(chunk) = pool_->chunks;
+      pool_->chunks = chunk;
+      ++pool_->chunk_count;
+      pool_->untouched = pool_->slots_per_chunk;
+    }
+    slot = static_cast<unsigned char*>(pool_->chunks) + kChunkHeader +
+           (pool_->slots_per_chunk - pool_->untouched) * kSlotSize;
+    --pool_->untouched;
+  }
+  ++pool_->live_nodes;
+  return static_cast<T*>(slot);
+}
+
+template<typename T>
+void NodePoolAllocator<T>::deallocate(T* ptr, std::size_t n) {
+  assert(pool_ != nullptr &&
+         "NodePoolAllocator: deallocate() after the allocator was moved");
+  if (!IsPooled(n)) {
+    std::allocator<T>().deallocate(ptr, n);
+    return;
+  }
+  FreeSlot* slot = reinterpret_cast<FreeSlot*>(ptr);
+  slot->next = pool_->free_list;
+  pool_->free_list = slot;
+  --pool_->live_nodes;
+}
+
+template<typename T>
+bool NodePoolAllocator<T>::ReleaseAll() {
+  if (pool_ == nullptr) {
+    return true;
+  }
+  if (pool_->users != 1) {
+    return false;
+  }
+  FreeChunks(pool_);
+  pool_->chunks = nullptr;
+  pool_->chunk_count = 0;
+  pool_->untouched = 0;
+  pool_->free_list = nullptr;
+  pool_->live_nodes = 0;
+  return true;
+}
+
+template<typename T>
+NodePoolStats NodePoolAllocator<T>::GetStats() const {
+  NodePoolStats stats;
+  if (pool_ != nullptr) {
+    stats.nodes_per_chunk = pool_->slots_per_chunk;
+    stats.chunks = pool_->chunk_count;
+    stats.live_nodes = pool_->live_nodes;
+  }
+  return stats;
+}
+
+}  // namespace containers
+
+#endif  // NODE_POOL_H_
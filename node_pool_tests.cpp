@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <set>
+#include "node_pool.h"
+
+using containers::NodePoolAllocator;
+
+namespace {
+
+struct alignas(32) Aligned {
+  char data[40];
+};
+
+}  // namespace
+
+TEST(Test_0, ReusingFreedNodes) {
+  NodePoolAllocator<int> allocator;
+  int* first = allocator.allocate(1);
+  int* second = allocator.allocate(1);
+  EXPECT_NE(first, second);
+  allocator.deallocate(first, 1);
+  EXPECT_EQ(allocator.allocate(1), first);
+  containers::NodePoolStats stats = allocator.GetStats();
+  EXPECT_EQ(stats.chunks, 1u);
+  EXPECT_EQ(stats.live_nodes, 2u);
+  allocator.deallocate(first, 1);
+  allocator.deallocate(second, 1);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 0u);
+}
+
+TEST(Test_1, Chunks) {
+  NodePoolAllocator<Aligned> allocator;
+  std::set<Aligned*> nodes;
+  nodes.insert(allocator.allocate(1));
+  std::size_t per_chunk = allocator.GetStats().nodes_per_chunk;
+  for (std::size_t i = 1; i < 2 * per_chunk + 1; ++i) {
+    Aligned* node = allocator.allocate(1);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(node) % alignof(Aligned), 0u);
+    nodes.insert(node);
+  }
+  EXPECT_EQ(nodes.size(), 2 * per_chunk + 1);
+  EXPECT_EQ(allocator.GetStats().chunks, 3u);
+  // Arrays don't use the pool.
+  Aligned* array = allocator.allocate(3);
+  allocator.deallocate(array, 3);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 2 * per_chunk + 1);
+  EXPECT_TRUE(allocator.ReleaseAll());
+  EXPECT_EQ(allocator.GetStats().chunks, 0u);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 0u);
+}
+
+TEST(Test_2, SharedPool) {
+  NodePoolAllocator<int> allocator;
+  int* node = allocator.allocate(1);
+  {
+    NodePoolAllocator<int> copy = allocator;
+    EXPECT_TRUE(copy == allocator);
+    EXPECT_FALSE(allocator.ReleaseAll());
+    copy.deallocate(node, 1);
+    EXPECT_EQ(allocator.GetStats().live_nodes, 0u);
+    EXPECT_TRUE(copy.select_on_container_copy_construction() != allocator);
+  }
+  NodePoolAllocator<int> moved = std::move(allocator);
+  EXPECT_EQ(moved.GetStats().chunks, 1u);
+  EXPECT_EQ(allocator.GetStats().chunks, 0u);
+  EXPECT_TRUE(moved.ReleaseAll());
+}
+
+TEST(Test_3, Rebinding) {
+  NodePoolAllocator<char> allocator;
+  NodePoolAllocator<double> rebound(allocator);
+  EXPECT_TRUE(rebound == allocator);
+  double* node = rebound.allocate(1);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 1u);
+  // The pool serves only the size it was used for first.
+  NodePoolAllocator<Aligned> other_size(allocator);
+  Aligned* other_node = other_size.allocate(1);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 1u);
+  other_size.deallocate(other_node, 1);
+  rebound.deallocate(node, 1);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 0u);
+}
+
+TEST(Test_4, MovedFromAllocator) {
+  NodePoolAllocator<int> allocator;
+  int* node = allocator.allocate(1);
+  NodePoolAllocator<int> moved = std::move(allocator);
+  // The moved-from allocator makes a new pool when it is used again.
+  int* other_node = allocator.allocate(1);
+  EXPECT_EQ(allocator.GetStats().live_nodes, 1u);
+  EXPECT_EQ(moved.GetStats().live_nodes, 1u);
+  allocator.deallocate(other_node, 1);
+  moved.deallocate(node, 1);
+#ifndef NDEBUG
+  NodePoolAllocator<int> emptied = std::move(moved);
+  EXPECT_DEATH(moved.deallocate(node, 1), "moved");
+#endif
+}
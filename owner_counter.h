@@ -0,0 +1,48 @@
+#ifndef OWNER_COUNTER_H_
+#define OWNER_COUNTER_H_
+
+#include <atomic>
+
+namespace pointers {
+
+// Counter that only its owner thread changes, while other threads may read
+// it at any time (for statistics, or the biased part of a reference count).
+// Since there is one writer, the owner changes it by a relaxed load and
+// store instead of a read-modify-write (a locked instruction on x86); the
+// counter is atomic only so that the readers don't race with it.
+// Ownership may pass to another thread, if the two are synchronized.
+template<typename T>
+class OwnerCounter {
+ public:
+  constexpr OwnerCounter() noexcept : value_() {}
+  constexpr explicit OwnerCounter(T value) noexcept : value_(value) {}
+  OwnerCounter(const OwnerCounter&) = delete;
+  OwnerCounter& operator=(const OwnerCounter&) = delete;
+
+  // Any thread.
+  T Load() const noexcept {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  // Owner thread only. Increment() and Decrement() return the new value.
+  void Store(T value) noexcept {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  T Increment() noexcept {
+    T value = Load() + 1;
+    Store(value);
+    return value;
+  }
+  T Decrement() noexcept {
+    T value = Load() - 1;
+    Store(value);
+    return value;
+  }
+
+ private:
+  std::atomic<T> value_;
+};
+
+}  // namespace pointers
+
+#endif  // OWNER_COUNTER_H_
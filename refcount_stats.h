@@ -0,0 +1,240 @@
+#ifndef REFCOUNT_STATS_H_
+#define REFCOUNT_STATS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "owner_counter.h"
+
+// Counting of reference counter operations, for finding code that
+// copies pointers too often. It is enabled for the whole program with
+//   -DPOINTERS_ENABLE_REFCOUNT_STATS
+// (all translation units must agree on it). Otherwise the hooks in
+// CounterManager, WeakPtr and the other pointers expand to nothing,
+// and the snapshot is empty.
+#ifdef POINTERS_ENABLE_REFCOUNT_STATS
+#define POINTERS_RECORD_REFCOUNT_EVENT(event) \
+  ::pointers::RefcountStats::Record(::pointers::RefcountEvent::event)
+#else
+#define POINTERS_RECORD_REFCOUNT_EVENT(event) static_cast<void>(0)
+#endif
+
+namespace pointers {
+
+enum class RefcountEvent {
+  kControlBlockAllocated,
+  kControlBlockFreed,
+  kStrongIncrement,
+  kStrongDecrement,
+  kWeakIncrement,
+  kWeakDecrement,
+  kLockSuccess,
+  kLockFailure,
+  // The object is owned by its first pointer. This pointer holds one
+  // strong reference and one weak one (the unit of all strong pointers),
+  // so they are counted as increments too.
+  kObjectCreated,
+  kObjectDestroyed,
+  kEventCount,
+};
+
+struct RefcountStatsSnapshot {
+  bool enabled = false;
+  std::uint64_t control_block_allocations = 0;
+  std::uint64_t control_block_frees = 0;
+  std::uint64_t strong_increments = 0;
+  std::uint64_t strong_decrements = 0;
+  std::uint64_t weak_increments = 0;
+  std::uint64_t weak_decrements = 0;
+  std::uint64_t lock_successes = 0;
+  std::uint64_t lock_failures = 0;
+  std::uint64_t objects_created = 0;
+  std::uint64_t objects_destroyed = 0;
+  // Objects that are created and not destroyed yet.
+  std::int64_t live_objects = 0;
+  std::int64_t peak_live_objects = 0;
+
+  // One "name: value" line per counter.
+  std::string ToText() const;
+  // Flat JSON object with the same names.
+  std::string ToJson() const;
+};
+
+// Every thread counts events in its own counters, they are summed up
+// only by GetSnapshot(). Live objects are counted globally, because their
+// peak can't be found from the counters of separate threads.
+class RefcountStats {
+ public:
+  static void Record(RefcountEvent event);
+  static RefcountStatsSnapshot GetSnapshot();
+
+ private:
+  static constexpr std::size_t kEventCount =
+      static_cast<std::size_t>(RefcountEvent::kEventCount);
+
+  struct ThreadCounters {
+    // Read by GetSnapshot().
+    OwnerCounter<std::uint64_t> counts[kEventCount];
+  };
+  struct RegisteredThreadCounters : ThreadCounters {
+    RegisteredThreadCounters();
+    ~RegisteredThreadCounters();
+  };
+  // Is never destroyed, like BlockPool.
+  struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> threads;
+    // Counters of finished threads.
+    std::atomic<std::uint64_t> retired[kEventCount] = {};
+    std::atomic<std::int64_t> live_objects{0};
+    std::atomic<std::int64_t> peak_live_objects{0};
+  };
+
+  static Registry& GetRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+  static ThreadCounters& LocalCounters() {
+    thread_local RegisteredThreadCounters counters;
+    return counters;
+  }
+  // Destructors of other thread_local objects may release pointers
+  // after the counters of their thread are gone.
+  static bool& IsThreadFinished() {
+    thread_local bool finished = false;
+    return finished;
+  }
+  static void UpdateLiveObjects(std::int64_t difference);
+};
+
+inline void RefcountStats::Record(RefcountEvent event) {
+  std::size_t index = static_cast<std::size_t>(event);
+  if (IsThreadFinished()) {
+    GetRegistry().retired[index].fetch_add(1, std::memory_order_relaxed);
+  } else {
+    LocalCounters().counts[index].Increment();
+  }
+  if (event == RefcountEvent::kObjectCreated) {
+    Record(RefcountEvent::kStrongIncrement);
+    Record(RefcountEvent::kWeakIncrement);
+    UpdateLiveObjects(1);
+  } else if (event == RefcountEvent::kObjectDestroyed) {
+    UpdateLiveObjects(-1);
+  }
+}
+
+inline RefcountStatsSnapshot RefcountStats::GetSnapshot() {
+  RefcountStatsSnapshot snapshot;
+#ifdef POINTERS_ENABLE_REFCOUNT_STATS
+  snapshot.enabled = true;
+#endif
+  std::uint64_t counts[kEventCount] = {};
+  Registry& registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (std::size_t i = 0; i < kEventCount; ++i) {
+      counts[i] = registry.retired[i].load(std::memory_order_relaxed);
+    }
+    for (const ThreadCounters* thread : registry.threads) {
+      for (std::size_t i = 0; i < kEventCount; ++i) {
+        counts[i] += thread->counts[i].Load();
+      }
+    }
+  }
+  auto get = [&counts](RefcountEvent event) {
+    return counts[static_cast<std::size_t>(event)];
+  };
+  snapshot.control_block_allocations =
+      get(RefcountEvent::kControlBlockAllocated);
+  snapshot.control_block_frees = get(RefcountEvent::kControlBlockFreed);
+  snapshot.strong_increments = get(RefcountEvent::kStrongIncrement);
+  snapshot.strong_decrements = get(RefcountEvent::kStrongDecrement);
+  snapshot.weak_increments = get(RefcountEvent::kWeakIncrement);
+  snapshot.weak_decrements = get(RefcountEvent::kWeakDecrement);
+  snapshot.lock_successes = get(RefcountEvent::kLockSuccess);
+  snapshot.lock_failures = get(RefcountEvent::kLockFailure);
+  snapshot.objects_created = get(RefcountEvent::kObjectCreated);
+  snapshot.objects_destroyed = get(RefcountEvent::kObjectDestroyed);
+  snapshot.live_objects =
+      registry.live_objects.load(std::memory_order_relaxed);
+  snapshot.peak_live_objects =
+      registry.peak_live_objects.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+inline RefcountStats::RegisteredThreadCounters::RegisteredThreadCounters() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.threads.push_back(this);
+}
+
+inline RefcountStats::RegisteredThreadCounters::~RegisteredThreadCounters() {
+  Registry& registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (std::size_t i = 0; i < kEventCount; ++i) {
+      registry.retired[i].fetch_add(counts[i].Load(),
+                                    std::memory_order_relaxed);
+    }
+    registry.threads.erase(std::find(registry.threads.begin(),
+                                     registry.threads.end(), this));
+  }
+  IsThreadFinished() = true;
+}
+
+inline void RefcountStats::UpdateLiveObjects(std::int64_t difference) {
+  Registry& registry = GetRegistry();
+  std::int64_t live = registry.live_objects.fetch_add(
+      difference, std::memory_order_relaxed) + difference;
+  std::int64_t peak = registry.peak_live_objects.load(
+      std::memory_order_relaxed);
+  while (live > peak &&
+         !registry.peak_live_objects.compare_exchange_weak(
+             peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+inline std::string RefcountStatsSnapshot::ToText() const {
+  std::ostringstream text;
+  text << "enabled: " << (enabled ? "true" : "false") << '\n'
+       << "control_block_allocations: " << control_block_allocations << '\n'
+       << "control_block_frees: " << control_block_frees << '\n'
+       << "strong_increments: " << strong_increments << '\n'
+       << "strong_decrements: " << strong_decrements << '\n'
+       << "weak_increments: " << weak_increments << '\n'
+       << "weak_decrements: " << weak_decrements << '\n'
+       << "lock_successes: " << lock_successes << '\n'
+       << "lock_failures: " << lock_failures << '\n'
+       << "objects_created: " << objects_created << '\n'
+       << "objects_destroyed: " << objects_destroyed << '\n'
+       << "live_objects: " << live_objects << '\n'
+       << "peak_live_objects: " << peak_live_objects << '\n';
+  return text.str();
+}
+
+inline std::string RefcountStatsSnapshot::ToJson() const {
+  std::ostringstream json;
+  json << "{\"enabled\": " << (enabled ? "true" : "false")
+       << ", \"control_block_allocations\": " << control_block_allocations
+       << ", \"control_block_frees\": " << control_block_frees
+       << ", \"strong_increments\": " << strong_increments
+       << ", \"strong_decrements\": " << strong_decrements
+       << ", \"weak_increments\": " << weak_increments
+       << ", \"weak_decrements\": " << weak_decrements
+       << ", \"lock_successes\": " << lock_successes
+       << ", \"lock_failures\": " << lock_failures
+       << ", \"objects_created\": " << objects_created
+       << ", \"objects_destroyed\": " << objects_destroyed
+       << ", \"live_objects\": " << live_objects
+       << ", \"peak_live_objects\": " << peak_live_objects << '}';
+  return json.str();
+}
+
+}  // namespace pointers
+
+#endif  // REFCOUNT_STATS_H_
@@ -0,0 +1,100 @@
+#define POINTERS_ENABLE_REFCOUNT_STATS
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "refcount_stats.h"
+#include "shared_ptr.h"
+#include "weak_ptr.h"
+
+using pointers::RefcountStats;
+using pointers::RefcountStatsSnapshot;
+using pointers::SharedPtr;
+using pointers::WeakPtr;
+
+TEST(Test_0, CountsEvents) {
+  RefcountStatsSnapshot before = RefcountStats::GetSnapshot();
+  EXPECT_TRUE(before.enabled);
+  {
+    SharedPtr<int> sptr_1(new int(1));
+    SharedPtr<int> sptr_2 = sptr_1;
+    SharedPtr<int> sptr_3 = pointers::MakeShared<int>(2);
+    WeakPtr<int> wptr(sptr_1);
+    EXPECT_TRUE(wptr.Lock() == sptr_1);
+    RefcountStatsSnapshot middle = RefcountStats::GetSnapshot();
+    EXPECT_EQ(middle.live_objects - before.live_objects, 2);
+    sptr_1.Reset();
+    sptr_2.Reset();
+    EXPECT_TRUE(wptr.Lock().Get() == nullptr);
+  }
+  RefcountStatsSnapshot after = RefcountStats::GetSnapshot();
+  EXPECT_EQ(after.control_block_allocations -
+                before.control_block_allocations, 2u);
+  EXPECT_EQ(after.control_block_frees - before.control_block_frees, 2u);
+  // sptr_1, sptr_2, sptr_3 and the locked copy.
+  EXPECT_EQ(after.strong_increments - before.strong_increments, 4u);
+  EXPECT_EQ(after.strong_decrements - before.strong_decrements, 4u);
+  // wptr and the unit of all SharedPtr-s of both objects.
+  EXPECT_EQ(after.weak_increments - before.weak_increments, 3u);
+  EXPECT_EQ(after.weak_decrements - before.weak_decrements, 3u);
+  EXPECT_EQ(after.lock_successes - before.lock_successes, 1u);
+  EXPECT_EQ(after.lock_failures - before.lock_failures, 1u);
+  EXPECT_EQ(after.objects_created - before.objects_created, 2u);
+  EXPECT_EQ(after.objects_destroyed - before.objects_destroyed, 2u);
+  EXPECT_EQ(after.live_objects, before.live_objects);
+  EXPECT_GE(after.peak_live_objects, before.live_objects + 2);
+}
+
+TEST(Test_1, AggregatesThreads) {
+  pointers::ConcurrentSharedPtr<int> sptr(new int(3));
+  RefcountStatsSnapshot before = RefcountStats::GetSnapshot();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&sptr]() {
+      for (int j = 0; j < 100; ++j) {
+        pointers::ConcurrentSharedPtr<int> copy = sptr;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  RefcountStatsSnapshot after = RefcountStats::GetSnapshot();
+  EXPECT_EQ(after.strong_increments - before.strong_increments, 400u);
+  EXPECT_EQ(after.strong_decrements - before.strong_decrements, 400u);
+}
+
+TEST(Test_2, ThrowingConstructors) {
+  struct Throwing {
+    Throwing() {
+      throw std::runtime_error("Throwing");
+    }
+  };
+  RefcountStatsSnapshot before = RefcountStats::GetSnapshot();
+  EXPECT_THROW(pointers::MakeShared<Throwing>(), std::runtime_error);
+  EXPECT_THROW(pointers::MakeSharedArray<Throwing>(3), std::runtime_error);
+  RefcountStatsSnapshot after = RefcountStats::GetSnapshot();
+  EXPECT_EQ(after.control_block_allocations -
+                before.control_block_allocations, 2u);
+  EXPECT_EQ(after.control_block_frees - before.control_block_frees, 2u);
+  EXPECT_EQ(after.objects_created, before.objects_created);
+  EXPECT_EQ(after.strong_increments, before.strong_increments);
+  EXPECT_EQ(after.weak_increments, before.weak_increments);
+  EXPECT_EQ(after.live_objects, before.live_objects);
+}
+
+TEST(Test_3, Export) {
+  RefcountStatsSnapshot snapshot;
+  snapshot.enabled = true;
+  snapshot.strong_increments = 7;
+  snapshot.peak_live_objects = 3;
+  std::string text = snapshot.ToText();
+  EXPECT_NE(text.find("strong_increments: 7\n"), std::string::npos);
+  EXPECT_NE(text.find("peak_live_objects: 3\n"), std::string::npos);
+  std::string json = snapshot.ToJson();
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_EQ(json.back(), '}');
+  EXPECT_NE(json.find("\"enabled\": true"), std::string::npos);
+  EXPECT_NE(json.find("\"strong_increments\": 7,"), std::string::npos);
+}
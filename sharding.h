@@ -0,0 +1,23 @@
+#ifndef SHARDING_H_
+#define SHARDING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Helpers for the caches that spread keys over shards, each with its own
+// mutex (pointers::WeakValueCache, containers::ShardedLruCache).
+namespace sharding {
+
+// Shards are aligned so that their mutexes don't share a cache line.
+constexpr std::size_t kShardAlignment = 64;
+
+// Shard of a key with the given hash. Fibonacci hashing is used, so the
+// shard doesn't depend on the same low bits as the bucket of the key
+// inside the shard.
+inline std::size_t ShardIndex(std::uint64_t hash, std::size_t shard_count) {
+  return (hash * 0x9E3779B97F4A7C15ull >> 32) % shard_count;
+}
+
+}  // namespace sharding
+
+#endif  // SHARDING_H_
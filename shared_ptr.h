@@ -1,243 +1,831 @@
 #ifndef SHARED_PTR_H_
 #define SHARED_PTR_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <ostream>
 #include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "block_pool.h"
+#include "refcount_stats.h"
 
 namespace pointers {
 
-template<typename T>
+// COUNTING POLICIES
+// A policy decides how CounterManager stores and changes its counters.
+// SingleThreadedCounting is the default one and is just plain int arithmetic,
+// AtomicCounting lets pointers to the same object live in different threads.
+struct SingleThreadedCounting {
+  using Counter = int;
+
+  static int Load(const Counter& counter) {
+    return counter;
+  }
+  static void Store(Counter& counter, int value) {
+    counter = value;
+  }
+  static void Increment(Counter& counter) {
+    ++counter;
+  }
+  // Returns the value of the counter after decrementing.
+  static int Decrement(Counter& counter) {
+    return --counter;
+  }
+  // Returns false (and does nothing) if the counter is zero.
+  static bool IncrementIfNonZero(Counter& counter) {
+    if (counter == 0) {
+      return false;
+    }
+    ++counter;
+    return true;
+  }
+};
+
+struct AtomicCounting {
+  using Counter = std::atomic<int>;
+
+  static int Load(const Counter& counter) {
+    return counter.load(std::memory_order_acquire);
+  }
+  static void Store(Counter& counter, int value) {
+    counter.store(value, std::memory_order_relaxed);
+  }
+  // New reference is always made from an existing one,
+  // so there is nothing to synchronize with here.
+  static void Increment(Counter& counter) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Release publishes our work with the object, acquire makes the work of
+  // all other owners visible to the thread that is going to destroy it.
+  static int Decrement(Counter& counter) {
+    return counter.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+  // Once the counter is zero the object is being destroyed,
+  // so it must never become positive again.
+  static bool IncrementIfNonZero(Counter& counter) {
+    int value = counter.load(std::memory_order_relaxed);
+    while (value != 0) {
+      if (counter.compare_exchange_weak(value, value + 1,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+class SharedPtr;
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
 class WeakPtr;
 
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+class EnableSharedFromThis;
+
+// Is true if T is derived from EnableSharedFromThis with the same policy.
+template<typename T, typename CountingPolicy, typename = void>
+struct HasSharedFromThis : std::false_type {};
+
+template<typename T, typename CountingPolicy>
+struct HasSharedFromThis<T, CountingPolicy,
+                         std::void_t<typename T::SharedFromThisType>>
+    : std::is_convertible<T*, const EnableSharedFromThis<
+          typename T::SharedFromThisType, CountingPolicy>*> {};
+
+// All SharedPtr-s together hold one unit of weak_validity_, so the manager
+// is deleted by whoever drops weak_validity_ to zero, and the object itself
+// by whoever drops counter_of_smart_ptr_ to zero.
+// The way the object and the manager are deleted depends on how they
+// were created, so it is hidden behind DeleteObject() and DeleteManager(),
+// which are only called at the very end of their lifetime.
+template<typename CountingPolicy = SingleThreadedCounting>
 class CounterManager {
  public:
-  CounterManager() = default;
-  ~CounterManager() = default;
+  using Policy = CountingPolicy;
+
+  // Manager is always created by its first SharedPtr.
+  CounterManager() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kControlBlockAllocated);
+  }
+  virtual ~CounterManager() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kControlBlockFreed);
+  }
 
   bool IsConnectedToPtr() const {
-    return counter_of_smart_ptr_ + weak_validity_ > 0;
+    return Policy::Load(weak_validity_) > 0;
+  }
+
+  // COUNTERS PROCESSING
+  int GetSharedCounter() const {
+    return Policy::Load(counter_of_smart_ptr_);
+  }
+  void AddShared() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kStrongIncrement);
+    Policy::Increment(counter_of_smart_ptr_);
+  }
+  // Used by WeakPtr::Lock(). Returns false if the object is already
+  // destroyed or is being destroyed by another thread.
+  bool TryAddShared() {
+    if (!Policy::IncrementIfNonZero(counter_of_smart_ptr_)) {
+      return false;
+    }
+    POINTERS_RECORD_REFCOUNT_EVENT(kStrongIncrement);
+    return true;
+  }
+  void ReleaseShared() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kStrongDecrement);
+    if (Policy::Decrement(counter_of_smart_ptr_) == 0) {
+      POINTERS_RECORD_REFCOUNT_EVENT(kObjectDestroyed);
+      DeleteObject();
+      ReleaseWeak();
+    }
+  }
+  void AddWeak() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kWeakIncrement);
+    Policy::Increment(weak_validity_);
+  }
+  void ReleaseWeak() {
+    POINTERS_RECORD_REFCOUNT_EVENT(kWeakDecrement);
+    if (Policy::Decrement(weak_validity_) == 0) {
+      DeleteManager();
+    }
   }
 
   CounterManager& operator=(const CounterManager& rhs) {
-    counter_of_smart_ptr_ = rhs.counter_of_smart_ptr_;
-    weak_validity_ = rhs.weak_validity_;
+    Policy::Store(counter_of_smart_ptr_,
+                  Policy::Load(rhs.counter_of_smart_ptr_));
+    Policy::Store(weak_validity_, Policy::Load(rhs.weak_validity_));
     return *this;
   }
   CounterManager& operator=(CounterManager&& rhs) noexcept {
-    this->counter_of_smart_ptr_ = rhs.counter_of_smart_ptr_;
-    this->weak_validity_ = rhs.weak_validity_;
-    rhs.counter_of_smart_ptr_ = 0;
-    rhs.weak_validity_ = 0;
+    (*this) = rhs;
+    Policy::Store(rhs.counter_of_smart_ptr_, 0);
+    Policy::Store(rhs.weak_validity_, 0);
     return *this;
   }
   bool operator==(const CounterManager& rhs) const {
-    return (this->counter_of_smart_ptr_ == rhs.counter_of_smart_ptr_ &&
-            this->weak_validity_ == rhs.weak_validity_);
+    return (Policy::Load(this->counter_of_smart_ptr_) ==
+                Policy::Load(rhs.counter_of_smart_ptr_) &&
+            Policy::Load(this->weak_validity_) ==
+                Policy::Load(rhs.weak_validity_));
   }
 
-  int counter_of_smart_ptr_ = 0;
-  int weak_validity_ = 0;
+  typename Policy::Counter counter_of_smart_ptr_{1};
+  typename Policy::Counter weak_validity_{1};
+
+ protected:
+  virtual void DeleteObject() = 0;
+  virtual void DeleteManager() = 0;
+};
+
+// DELETERS AND ALLOCATORS
+
+template<typename T>
+struct DefaultDelete {
+  void operator()(T* ptr) const {
+    delete ptr;
+  }
 };
 
 template<typename T>
+struct DefaultDelete<T[]> {
+  void operator()(T* ptr) const {
+    delete[] ptr;
+  }
+};
+
+// Keeps a deleter or an allocator of the manager.
+// Ones without state are kept as empty base classes and take no space.
+template<int Index, typename T,
+         bool = std::is_empty<T>::value && !std::is_final<T>::value>
+class CompressedStorage : private T {
+ public:
+  explicit CompressedStorage(T value) : T(std::move(value)) {}
+
+  T& GetStored() {
+    return *this;
+  }
+};
+
+template<int Index, typename T>
+class CompressedStorage<Index, T, false> {
+ public:
+  explicit CompressedStorage(T value) : value_(std::move(value)) {}
+
+  T& GetStored() {
+    return value_;
+  }
+
+ private:
+  T value_;
+};
+
+// Manager of an object that was allocated separately by the user.
+// Managers are created for every SharedPtr(T*), so by default they are
+// taken from BlockPool instead of the general heap.
+// The manager itself is allocated by Allocator (rebound to its own type),
+// the object is deleted by Deleter.
+template<typename T, typename CountingPolicy,
+         typename Deleter = DefaultDelete<T>,
+         typename Allocator = BlockPoolAllocator<T>>
+class PointerCounterManager
+    : public CounterManager<CountingPolicy>,
+      private CompressedStorage<0, Deleter>,
+      private CompressedStorage<1, typename std::allocator_traits<
+          Allocator>::template rebind_alloc<PointerCounterManager<
+              T, CountingPolicy, Deleter, Allocator>>> {
+ public:
+  using ManagerAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<PointerCounterManager>;
+
+  static PointerCounterManager* Create(T* ptr, Deleter deleter,
+                                       const Allocator& allocator);
+
+ protected:
+  void DeleteObject() override {
+    GetDeleter()(object_);
+  }
+  void DeleteManager() override;
+
+ private:
+  using DeleterStorage = CompressedStorage<0, Deleter>;
+  using AllocatorStorage = CompressedStorage<1, ManagerAllocator>;
+
+  PointerCounterManager(T* ptr, Deleter deleter, ManagerAllocator allocator)
+      : DeleterStorage(std::move(deleter)),
+        AllocatorStorage(std::move(allocator)), object_(ptr) {}
+
+  Deleter& GetDeleter() {
+    return DeleterStorage::GetStored();
+  }
+
+  T* object_;
+};
+
+template<typename T, typename CountingPolicy, typename Deleter,
+         typename Allocator>
+PointerCounterManager<T, CountingPolicy, Deleter, Allocator>*
+    PointerCounterManager<T, CountingPolicy, Deleter, Allocator>::Create(
+        T* ptr, Deleter deleter, const Allocator& allocator) {
+  ManagerAllocator manager_allocator(allocator);
+  PointerCounterManager* manager;
+  try {
+    manager = std::allocator_traits<ManagerAllocator>::allocate(
+        manager_allocator, 1);
+  } catch (...) {
+    // Like std::shared_ptr, the object is not leaked.
+    deleter(ptr);
+    throw;
+  }
+  new (manager) PointerCounterManager(ptr, std::move(deleter),
+                                      std::move(manager_allocator));
+  POINTERS_RECORD_REFCOUNT_EVENT(kObjectCreated);
+  return manager;
+}
+
+template<typename T, typename CountingPolicy, typename Deleter,
+         typename Allocator>
+void PointerCounterManager<T, CountingPolicy, Deleter,
+                           Allocator>::DeleteManager() {
+  ManagerAllocator allocator(std::move(AllocatorStorage::GetStored()));
+  this->~PointerCounterManager();
+  std::allocator_traits<ManagerAllocator>::deallocate(allocator, this, 1);
+}
+
+// Manager that keeps the object inside itself, so both of them
+// are placed in one allocation. Object is destroyed with the last SharedPtr,
+// but its memory is freed together with the manager.
+template<typename T, typename CountingPolicy,
+         typename Allocator = std::allocator<T>>
+class ObjectCounterManager
+    : public CounterManager<CountingPolicy>,
+      private CompressedStorage<1, typename std::allocator_traits<
+          Allocator>::template rebind_alloc<ObjectCounterManager<
+              T, CountingPolicy, Allocator>>> {
+ public:
+  using ManagerAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<ObjectCounterManager>;
+
+  template<typename... Args>
+  static ObjectCounterManager* Create(const Allocator& allocator,
+                                      Args&&... args);
+
+  T* GetObject() {
+    return reinterpret_cast<T*>(&storage_);
+  }
+
+ protected:
+  void DeleteObject() override {
+    GetObject()->~T();
+  }
+  void DeleteManager() override;
+
+ private:
+  using AllocatorStorage = CompressedStorage<1, ManagerAllocator>;
+
+  template<typename... Args>
+  explicit ObjectCounterManager(ManagerAllocator allocator, Args&&... args)
+      : AllocatorStorage(std::move(allocator)) {
+    new (&storage_) T(std::forward<Args>(args)...);
+  }
+
+  alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+template<typename T, typename CountingPolicy, typename Allocator>
+template<typename... Args>
+ObjectCounterManager<T, CountingPolicy, Allocator>*
+    ObjectCounterManager<T, CountingPolicy, Allocator>::Create(
+        const Allocator& allocator, Args&&... args) {
+  ManagerAllocator manager_allocator(allocator);
+  ObjectCounterManager* manager =
+      std::allocator_traits<ManagerAllocator>::allocate(manager_allocator, 1);
+  try {
+    // The allocator is copied, as it is still needed if T() throws.
+    new (manager) ObjectCounterManager(manager_allocator,
+                                       std::forward<Args>(args)...);
+  } catch (...) {
+    std::allocator_traits<ManagerAllocator>::deallocate(manager_allocator,
+                                                        manager, 1);
+    throw;
+  }
+  POINTERS_RECORD_REFCOUNT_EVENT(kObjectCreated);
+  return manager;
+}
+
+template<typename T, typename CountingPolicy, typename Allocator>
+void ObjectCounterManager<T, CountingPolicy, Allocator>::DeleteManager() {
+  ManagerAllocator allocator(std::move(AllocatorStorage::GetStored()));
+  this->~ObjectCounterManager();
+  std::allocator_traits<ManagerAllocator>::deallocate(allocator, this, 1);
+}
+
+// Manager that keeps the elements of an array right after itself,
+// so SharedPtr<T[]> from MakeSharedArray needs a single allocation.
+// Elements are destroyed in reverse order with the last SharedPtr.
+template<typename T, typename CountingPolicy>
+class ArrayCounterManager : public CounterManager<CountingPolicy> {
+ public:
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "over-aligned elements are not supported");
+
+  // Every element is created as T(args...), T() is value-initialization.
+  template<typename... Args>
+  static ArrayCounterManager* Create(std::size_t size, const Args&... args);
+
+  T* GetElements() {
+    return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(this) +
+                                GetElementsOffset());
+  }
+
+ protected:
+  void DeleteObject() override {
+    DestroyElements(size_);
+  }
+  void DeleteManager() override {
+    this->~ArrayCounterManager();
+    ::operator delete(this);
+  }
+
+ private:
+  explicit ArrayCounterManager(std::size_t size) : size_(size) {}
+
+  static constexpr std::size_t GetElementsOffset() {
+    return (sizeof(ArrayCounterManager) + alignof(T) - 1) / alignof(T) *
+           alignof(T);
+  }
+  // Destroys the first `count` elements.
+  void DestroyElements(std::size_t count) {
+    T* elements = GetElements();
+    while (count > 0) {
+      elements[--count].~T();
+    }
+  }
+
+  std::size_t size_;
+};
+
+template<typename T, typename CountingPolicy>
+template<typename... Args>
+ArrayCounterManager<T, CountingPolicy>*
+    ArrayCounterManager<T, CountingPolicy>::Create(std::size_t size,
+                                                    const Args&... args) {
+  if (size > (SIZE_MAX - GetElementsOffset()) / sizeof(T)) {
+    throw std::bad_array_new_length();
+  }
+  void* memory = ::operator new(GetElementsOffset() + size * sizeof(T));
+  ArrayCounterManager* manager = new (memory) ArrayCounterManager(size);
+  T* elements = manager->GetElements();
+  std::size_t created = 0;
+  try {
+    for (; created < size; ++created) {
+      new (elements + created) T(args...);
+    }
+  } catch (...) {
+    manager->DestroyElements(created);
+    manager->~ArrayCounterManager();
+    ::operator delete(memory);
+    throw;
+  }
+  POINTERS_RECORD_REFCOUNT_EVENT(kObjectCreated);
+  return manager;
+}
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting,
+         typename... Args>
+SharedPtr<T, CountingPolicy> MakeShared(Args&&... args);
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting,
+         typename Allocator, typename... Args>
+SharedPtr<T, CountingPolicy> AllocateShared(const Allocator& allocator,
+                                            Args&&... args);
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+SharedPtr<T[], CountingPolicy> MakeSharedArray(std::size_t size);
+
+template<typename T, typename CountingPolicy = SingleThreadedCounting>
+SharedPtr<T[], CountingPolicy> MakeSharedArray(std::size_t size,
+                                               const T& value);
+
+// Statistics of the pool that managers of SharedPtr(T*) are taken from.
+template<typename CountingPolicy = SingleThreadedCounting>
+BlockPoolStats GetCounterManagerPoolStats() {
+  using Manager = PointerCounterManager<char, CountingPolicy>;
+  return BlockPool<sizeof(Manager), alignof(Manager)>::Instance().GetStats();
+}
+
+template<typename T, typename CountingPolicy>
 class SharedPtr {
  public:
-  friend class WeakPtr<T>;
+  template<typename U, typename Policy>
+  friend class SharedPtr;
+  template<typename U, typename Policy>
+  friend class WeakPtr;
+  template<typename U, typename Policy, typename... Args>
+  friend SharedPtr<U, Policy> MakeShared(Args&&... args);
+  template<typename U, typename Policy, typename Allocator, typename... Args>
+  friend SharedPtr<U, Policy> AllocateShared(const Allocator& allocator,
+                                             Args&&... args);
+  template<typename U, typename Policy>
+  friend SharedPtr<U[], Policy> MakeSharedArray(std::size_t size);
+  template<typename U, typename Policy>
+  friend SharedPtr<U[], Policy> MakeSharedArray(std::size_t size,
+                                                const U& value);
+  using Manager = CounterManager<CountingPolicy>;
+  // SharedPtr<T[]> points to the first element of an array.
+  using ElementType = std::remove_extent_t<T>;
 
   // CONSTRUCTORS
   SharedPtr() = default;
-  explicit SharedPtr(T* ptr);
-  SharedPtr(const SharedPtr<T>& other_pointer);
-  SharedPtr(SharedPtr<T>&& other_pointer) noexcept;
+  explicit SharedPtr(ElementType* ptr);
+  // Deleter is called instead of delete, when the last SharedPtr is gone.
+  // Allocator is used for the manager, that keeps the deleter.
+  template<typename Deleter,
+           typename Allocator = BlockPoolAllocator<ElementType>>
+  SharedPtr(ElementType* ptr, Deleter deleter,
+            const Allocator& allocator = Allocator());
+  SharedPtr(const SharedPtr& other_pointer);
+  SharedPtr(SharedPtr&& other_pointer) noexcept;
+  // Converting constructors (e.g. SharedPtr<Derived> -> SharedPtr<Base>),
+  // the object is still deleted as U.
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  SharedPtr(const SharedPtr<U, CountingPolicy>& other_pointer);
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  SharedPtr(SharedPtr<U, CountingPolicy>&& other_pointer) noexcept;
+  // Aliasing constructors: share the manager of `owner`, but point to `ptr`
+  // (usually a member of the owned object), so no allocation is needed.
+  template<typename U>
+  SharedPtr(const SharedPtr<U, CountingPolicy>& owner, ElementType* ptr);
+  template<typename U>
+  SharedPtr(SharedPtr<U, CountingPolicy>&& owner, ElementType* ptr) noexcept;
 
   // DELETING OPERATORS
   ~SharedPtr();
   void Reset();
 
   // ASSIGMENT OPERATORS
-  SharedPtr& operator=(const SharedPtr<T>& rhs);
-  SharedPtr& operator=(SharedPtr<T>&& rhs) noexcept;
+  SharedPtr& operator=(const SharedPtr& rhs);
+  SharedPtr& operator=(SharedPtr&& rhs) noexcept;
 
   // GETTERS
   int GetCounter() const {
-    return (get_ != nullptr) ? (get_->counter_of_smart_ptr_) : 0;
+    return (get_ != nullptr) ? (get_->GetSharedCounter()) : 0;
   }
 
-  T* Get() {
+  ElementType* Get() {
     return inner_pointer_;
   }
-  const T* Get() const {
+  const ElementType* Get() const {
     return inner_pointer_;
   }
 
-  T& operator*();
-  const T& operator*() const;
+  ElementType& operator*();
+  const ElementType& operator*() const;
+
+  ElementType* operator->();
+  const ElementType* operator->() const;
 
-  T* operator->();
-  const T* operator->() const;
+  // Only for SharedPtr<T[]>.
+  ElementType& operator[](std::ptrdiff_t index);
+  const ElementType& operator[](std::ptrdiff_t index) const;
 
   // COMPARING OPERATORS
-  bool operator==(const T* rhs) const;
-  bool operator==(const SharedPtr<T>& rhs) const;
+  bool operator==(const ElementType* rhs) const;
+  bool operator==(const SharedPtr& rhs) const;
 
-  bool operator!=(const SharedPtr<T>& rhs) const;
-  bool operator!=(const T* rhs) const;
+  bool operator!=(const SharedPtr& rhs) const;
+  bool operator!=(const ElementType* rhs) const;
 
-  friend bool operator==(const T* lhs, const SharedPtr<T> rhs) {
+  friend bool operator==(const ElementType* lhs, const SharedPtr rhs) {
     return lhs == rhs.inner_pointer_;
   }
-  friend bool operator!=(const T* lhs, const SharedPtr<T> rhs) {
+  friend bool operator!=(const ElementType* lhs, const SharedPtr rhs) {
     return rhs != lhs;
   }
 
  private:
-  T* inner_pointer_{nullptr};
-  CounterManager* get_{};
+  // Takes the reference that the manager was created with.
+  SharedPtr(Manager* manager, ElementType* ptr)
+      : inner_pointer_(ptr), get_(manager) {}
+
+  // Called by the first owner of the object.
+  void ConnectSharedFromThis();
+
+  ElementType* inner_pointer_{nullptr};
+  Manager* get_{};
 };
 
+// Thread-safe version, copies of which can be passed between threads.
+template<typename T>
+using ConcurrentSharedPtr = SharedPtr<T, AtomicCounting>;
+
 // CONSTRUCTORS
 
-template<typename T>
-SharedPtr<T>::SharedPtr(T* ptr) {
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>::SharedPtr(ElementType* ptr)
+    : SharedPtr(ptr, DefaultDelete<T>()) {}
+
+template<typename T, typename CountingPolicy>
+template<typename Deleter, typename Allocator>
+SharedPtr<T, CountingPolicy>::SharedPtr(ElementType* ptr, Deleter deleter,
+                                        const Allocator& allocator) {
   inner_pointer_ = ptr;
   if (ptr != nullptr) {
-    get_ = new CounterManager();
-    get_->counter_of_smart_ptr_ = 1;
+    get_ = PointerCounterManager<ElementType, CountingPolicy, Deleter,
+                                 Allocator>::Create(ptr, std::move(deleter),
+                                                    allocator);
+    ConnectSharedFromThis();
   }
 }
 
-template<typename T>
-SharedPtr<T>::SharedPtr(const SharedPtr<T>& other_pointer) {
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>::SharedPtr(const SharedPtr& other_pointer) {
   (*this) = other_pointer;
 }
 
-template<typename T>
-SharedPtr<T>::SharedPtr(SharedPtr<T>&& other_pointer) noexcept {
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>::SharedPtr(SharedPtr&& other_pointer) noexcept {
   (*this) = std::move(other_pointer);
 }
 
+template<typename T, typename CountingPolicy>
+template<typename U, typename>
+SharedPtr<T, CountingPolicy>::SharedPtr(
+    const SharedPtr<U, CountingPolicy>& other_pointer)
+    : SharedPtr(other_pointer, other_pointer.inner_pointer_) {}
+
+template<typename T, typename CountingPolicy>
+template<typename U, typename>
+SharedPtr<T, CountingPolicy>::SharedPtr(
+    SharedPtr<U, CountingPolicy>&& other_pointer) noexcept
+    : SharedPtr(std::move(other_pointer), other_pointer.inner_pointer_) {}
+
+template<typename T, typename CountingPolicy>
+template<typename U>
+SharedPtr<T, CountingPolicy>::SharedPtr(
+    const SharedPtr<U, CountingPolicy>& owner, ElementType* ptr)
+    : inner_pointer_(ptr), get_(owner.get_) {
+  if (get_ != nullptr) {
+    get_->AddShared();
+  }
+}
+
+template<typename T, typename CountingPolicy>
+template<typename U>
+SharedPtr<T, CountingPolicy>::SharedPtr(SharedPtr<U, CountingPolicy>&& owner,
+                                        ElementType* ptr) noexcept
+    : inner_pointer_(ptr), get_(owner.get_) {
+  owner.inner_pointer_ = nullptr;
+  owner.get_ = nullptr;
+}
+
 // DELETING OPERATORS
 
-template<typename T>
-SharedPtr<T>::~SharedPtr() {
-  if (get_ == nullptr) {
-    return;
-  }
-  (get_->counter_of_smart_ptr_)--;
-  if (get_->counter_of_smart_ptr_ == 0) {
-    delete inner_pointer_;
-    if (!get_->IsConnectedToPtr()) {
-      delete get_;
-    }
-    get_ = nullptr;
-    inner_pointer_ = nullptr;
-  } else {
-    get_ = nullptr;
-    inner_pointer_ = nullptr;
-  }
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>::~SharedPtr() {
+  this->Reset();
 }
 
-template<typename T>
-void SharedPtr<T>::Reset() {
+template<typename T, typename CountingPolicy>
+void SharedPtr<T, CountingPolicy>::Reset() {
   if (get_ == nullptr) {
     return;
   }
-  (get_->counter_of_smart_ptr_)--;
-  if (get_->counter_of_smart_ptr_ == 0) {
-    delete inner_pointer_;
-    if (!get_->IsConnectedToPtr()) {
-      delete get_;
-    }
-  }
+  get_->ReleaseShared();
   get_ = nullptr;
   inner_pointer_ = nullptr;
 }
 
 // ASSIGMENT OPERATORS
 
-template<typename T>
-SharedPtr<T>& SharedPtr<T>::operator=(const SharedPtr<T>& rhs) {
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>& SharedPtr<T, CountingPolicy>::operator=(
+    const SharedPtr& rhs) {
   if (this == &rhs) {
     return *this;
   }
+  if (rhs.get_ != nullptr) {
+    rhs.get_->AddShared();
+  }
   this->Reset();
   inner_pointer_ = rhs.inner_pointer_;
   get_ = rhs.get_;
-  if (rhs.get_ != nullptr) {
-    (get_->counter_of_smart_ptr_)++;
-  }
   return *this;
 }
 
-template<typename T>
-SharedPtr<T>& SharedPtr<T>::operator=(SharedPtr<T>&& rhs) noexcept {
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy>& SharedPtr<T, CountingPolicy>::operator=(
+    SharedPtr&& rhs) noexcept {
   if (this == &rhs) {
     return *this;
   }
-  if (rhs.get_ != nullptr && inner_pointer_ == rhs.inner_pointer_) {
-    (rhs.get_->counter_of_smart_ptr_)--;
+  if (rhs.get_ != nullptr && get_ == rhs.get_) {
+    // Both pointers own the object, so it is not the last reference.
+    rhs.get_->ReleaseShared();
+    inner_pointer_ = rhs.inner_pointer_;
     rhs.inner_pointer_ = nullptr;
     rhs.get_ = nullptr;
     return *this;
   }
   this->Reset();
-  inner_pointer_ = std::move(rhs.inner_pointer_);
-  get_ = std::move(rhs.get_);
+  inner_pointer_ = rhs.inner_pointer_;
+  get_ = rhs.get_;
   rhs.inner_pointer_ = nullptr;
   rhs.get_ = nullptr;
   return *this;
 }
 
+template<typename T, typename CountingPolicy>
+void SharedPtr<T, CountingPolicy>::ConnectSharedFromThis() {
+  if constexpr (HasSharedFromThis<std::remove_cv_t<T>,
+                                  CountingPolicy>::value) {
+    using Object = typename std::remove_cv_t<T>::SharedFromThisType;
+    const EnableSharedFromThis<Object, CountingPolicy>* base = inner_pointer_;
+    // Object that is already owned keeps its first owner.
+    if (base->weak_this_.Expired()) {
+      // SharedPtr<const T> owns a non-const object as well.
+      Object* object = const_cast<std::remove_cv_t<T>*>(inner_pointer_);
+      base->weak_this_ = WeakPtr<Object, CountingPolicy>(
+          SharedPtr<Object, CountingPolicy>(*this, object));
+    }
+  }
+}
+
 // COMPARING OPERATORS
 
-template<typename T>
-bool SharedPtr<T>::operator==(const T* rhs) const {
+template<typename T, typename CountingPolicy>
+bool SharedPtr<T, CountingPolicy>::operator==(const ElementType* rhs) const {
   return (inner_pointer_ == rhs);
 }
 
-template<typename T>
-bool SharedPtr<T>::operator==(const SharedPtr<T>& rhs) const {
+template<typename T, typename CountingPolicy>
+bool SharedPtr<T, CountingPolicy>::operator==(const SharedPtr& rhs) const {
   if (inner_pointer_ == rhs.inner_pointer_ && get_ == rhs.get_) {
     return true;
   }
   return false;
 }
 
-template<typename T>
-bool SharedPtr<T>::operator!=(const SharedPtr<T>& rhs) const {
+template<typename T, typename CountingPolicy>
+bool SharedPtr<T, CountingPolicy>::operator!=(const SharedPtr& rhs) const {
   return !((*this) == rhs);
 }
 
-template<typename T>
-bool SharedPtr<T>::operator!=(const T* rhs) const {
+template<typename T, typename CountingPolicy>
+bool SharedPtr<T, CountingPolicy>::operator!=(const ElementType* rhs) const {
   return inner_pointer_ != rhs;
 }
 
 // GETTERS
 
-template<typename T>
-T& SharedPtr<T>::operator*() {
+template<typename T, typename CountingPolicy>
+typename SharedPtr<T, CountingPolicy>::ElementType&
+    SharedPtr<T, CountingPolicy>::operator*() {
   assert(inner_pointer_ != nullptr);
   return *inner_pointer_;
 }
 
-template<typename T>
-const T& SharedPtr<T>::operator*() const {
+template<typename T, typename CountingPolicy>
+const typename SharedPtr<T, CountingPolicy>::ElementType&
+    SharedPtr<T, CountingPolicy>::operator*() const {
   assert(inner_pointer_ != nullptr);
   return *inner_pointer_;
 }
 
-template<typename T>
-T* SharedPtr<T>::operator->() {
+template<typename T, typename CountingPolicy>
+typename SharedPtr<T, CountingPolicy>::ElementType*
+    SharedPtr<T, CountingPolicy>::operator->() {
   return inner_pointer_;
 }
 
-template<typename T>
-const T* SharedPtr<T>::operator->() const {
+template<typename T, typename CountingPolicy>
+const typename SharedPtr<T, CountingPolicy>::ElementType*
+    SharedPtr<T, CountingPolicy>::operator->() const {
   return inner_pointer_;
 }
 
+template<typename T, typename CountingPolicy>
+typename SharedPtr<T, CountingPolicy>::ElementType&
+    SharedPtr<T, CountingPolicy>::operator[](std::ptrdiff_t index) {
+  static_assert(std::is_array<T>::value, "operator[] needs SharedPtr<T[]>");
+  assert(inner_pointer_ != nullptr);
+  return inner_pointer_[index];
+}
+
+template<typename T, typename CountingPolicy>
+const typename SharedPtr<T, CountingPolicy>::ElementType&
+    SharedPtr<T, CountingPolicy>::operator[](std::ptrdiff_t index) const {
+  static_assert(std::is_array<T>::value, "operator[] needs SharedPtr<T[]>");
+  assert(inner_pointer_ != nullptr);
+  return inner_pointer_[index];
+}
+
+// FACTORIES
+
+// Creates the object and its manager in one allocation.
+template<typename T, typename CountingPolicy, typename... Args>
+SharedPtr<T, CountingPolicy> MakeShared(Args&&... args) {
+  return AllocateShared<T, CountingPolicy>(std::allocator<T>(),
+                                           std::forward<Args>(args)...);
+}
+
+// Same as MakeShared, but the memory is taken from the given allocator.
+template<typename T, typename CountingPolicy, typename Allocator,
+         typename... Args>
+SharedPtr<T, CountingPolicy> AllocateShared(const Allocator& allocator,
+                                            Args&&... args) {
+  auto* manager = ObjectCounterManager<T, CountingPolicy, Allocator>::Create(
+      allocator, std::forward<Args>(args)...);
+  SharedPtr<T, CountingPolicy> shared_ptr(manager, manager->GetObject());
+  shared_ptr.ConnectSharedFromThis();
+  return shared_ptr;
+}
+
+// Creates `size` value-initialized elements and their manager
+// in one allocation.
+template<typename T, typename CountingPolicy>
+SharedPtr<T[], CountingPolicy> MakeSharedArray(std::size_t size) {
+  auto* manager = ArrayCounterManager<T, CountingPolicy>::Create(size);
+  return SharedPtr<T[], CountingPolicy>(manager, manager->GetElements());
+}
+
+// Same, but every element is a copy of `value`.
+template<typename T, typename CountingPolicy>
+SharedPtr<T[], CountingPolicy> MakeSharedArray(std::size_t size,
+                                               const T& value) {
+  auto* manager = ArrayCounterManager<T, CountingPolicy>::Create(size, value);
+  return SharedPtr<T[], CountingPolicy>(manager, manager->GetElements());
+}
+
+// CASTS
+
+template<typename T, typename U, typename CountingPolicy>
+SharedPtr<T, CountingPolicy> StaticPointerCast(
+    const SharedPtr<U, CountingPolicy>& ptr) {
+  return SharedPtr<T, CountingPolicy>(
+      ptr, static_cast<T*>(const_cast<U*>(ptr.Get())));
+}
+
+// Returns empty pointer if the object is not T.
+template<typename T, typename U, typename CountingPolicy>
+SharedPtr<T, CountingPolicy> DynamicPointerCast(
+    const SharedPtr<U, CountingPolicy>& ptr) {
+  T* casted = dynamic_cast<T*>(const_cast<U*>(ptr.Get()));
+  if (casted == nullptr) {
+    return SharedPtr<T, CountingPolicy>();
+  }
+  return SharedPtr<T, CountingPolicy>(ptr, casted);
+}
+
 }  // namespace pointers
 
 #endif  // SHARED_PTR_H_
@@ -0,0 +1,209 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "shared_ptr.h"
+#include "weak_ptr.h"
+
+// Compares SharedPtr and WeakPtr with std::shared_ptr and std::weak_ptr.
+// Results of two releases can be diffed with compare.py from Google
+// Benchmark tools after running both of them with
+//   --benchmark_out=results.json --benchmark_out_format=json
+
+using pointers::AtomicCounting;
+using pointers::SingleThreadedCounting;
+
+namespace {
+
+struct Message {
+  int id = 0;
+  int payload[15] = {};
+};
+
+struct Node {
+  int value = 0;
+};
+
+// Gives the same interface to both libraries.
+struct StdPointers {
+  template<typename T>
+  using Shared = std::shared_ptr<T>;
+  template<typename T>
+  using Weak = std::weak_ptr<T>;
+
+  template<typename T>
+  static Shared<T> Make() {
+    return std::make_shared<T>();
+  }
+  template<typename T>
+  static Weak<T> MakeWeak(const Shared<T>& ptr) {
+    return Weak<T>(ptr);
+  }
+  template<typename T>
+  static void Reset(Shared<T>& ptr) {
+    ptr.reset();
+  }
+  template<typename T>
+  static Shared<T> Lock(const Weak<T>& ptr) {
+    return ptr.lock();
+  }
+  template<typename T>
+  static bool Expired(const Weak<T>& ptr) {
+    return ptr.expired();
+  }
+};
+
+template<typename CountingPolicy>
+struct OurPointers {
+  template<typename T>
+  using Shared = pointers::SharedPtr<T, CountingPolicy>;
+  template<typename T>
+  using Weak = pointers::WeakPtr<T, CountingPolicy>;
+
+  template<typename T>
+  static Shared<T> Make() {
+    return pointers::MakeShared<T, CountingPolicy>();
+  }
+  template<typename T>
+  static Weak<T> MakeWeak(const Shared<T>& ptr) {
+    return Weak<T>(ptr);
+  }
+  template<typename T>
+  static void Reset(Shared<T>& ptr) {
+    ptr.Reset();
+  }
+  template<typename T>
+  static Shared<T> Lock(const Weak<T>& ptr) {
+    return ptr.Lock();
+  }
+  template<typename T>
+  static bool Expired(const Weak<T>& ptr) {
+    return ptr.Expired();
+  }
+};
+
+using SingleThreaded = OurPointers<SingleThreadedCounting>;
+using Atomic = OurPointers<AtomicCounting>;
+
+// Object shared by all threads of a benchmark.
+template<typename Pointers>
+typename Pointers::template Shared<Message>& SharedMessage() {
+  static auto message = Pointers::template Make<Message>();
+  return message;
+}
+
+template<typename Pointers>
+void BM_ConstructFromPointer(benchmark::State& state) {
+  for (auto _ : state) {
+    typename Pointers::template Shared<Message> ptr(new Message());
+    benchmark::DoNotOptimize(ptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Pointers>
+void BM_MakeShared(benchmark::State& state) {
+  for (auto _ : state) {
+    auto ptr = Pointers::template Make<Message>();
+    benchmark::DoNotOptimize(ptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// All threads copy the same pointer, so its counter is contended.
+template<typename Pointers>
+void BM_Copy(benchmark::State& state) {
+  const auto& message = SharedMessage<Pointers>();
+  for (auto _ : state) {
+    auto copy = message;
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Pointers>
+void BM_Move(benchmark::State& state) {
+  auto first = Pointers::template Make<Message>();
+  decltype(first) second;
+  for (auto _ : state) {
+    second = std::move(first);
+    first = std::move(second);
+    benchmark::DoNotOptimize(first);
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+}
+
+// Copy and Reset of the copy, measured together, as Reset of the last
+// pointer would measure destruction of the object too.
+template<typename Pointers>
+void BM_CopyAndReset(benchmark::State& state) {
+  const auto& message = SharedMessage<Pointers>();
+  for (auto _ : state) {
+    auto copy = message;
+    Pointers::Reset(copy);
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Pointers>
+void BM_Lock(benchmark::State& state) {
+  auto weak = Pointers::MakeWeak(SharedMessage<Pointers>());
+  for (auto _ : state) {
+    auto locked = Pointers::Lock(weak);
+    benchmark::DoNotOptimize(locked);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Pointers>
+void BM_Expired(benchmark::State& state) {
+  auto weak = Pointers::MakeWeak(SharedMessage<Pointers>());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Pointers::Expired(weak));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Destruction of state.range(0) nodes, every of which is held by two
+// pointers, like in a graph with shared vertices. Only destruction
+// is timed.
+template<typename Pointers>
+void BM_DestroyGraph(benchmark::State& state) {
+  std::size_t size = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<typename Pointers::template Shared<Node>> nodes;
+    nodes.reserve(2 * size);
+    for (std::size_t i = 0; i < size; ++i) {
+      nodes.push_back(Pointers::template Make<Node>());
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      nodes.push_back(nodes[(i * 7919) % size]);
+    }
+    state.ResumeTiming();
+    nodes.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+#define POINTERS_BENCHMARK(name)                                  \
+  BENCHMARK_TEMPLATE(name, StdPointers)->ThreadRange(1, 8);       \
+  BENCHMARK_TEMPLATE(name, SingleThreaded);                       \
+  BENCHMARK_TEMPLATE(name, Atomic)->ThreadRange(1, 8)
+
+POINTERS_BENCHMARK(BM_ConstructFromPointer);
+POINTERS_BENCHMARK(BM_MakeShared);
+POINTERS_BENCHMARK(BM_Copy);
+POINTERS_BENCHMARK(BM_Move);
+POINTERS_BENCHMARK(BM_CopyAndReset);
+POINTERS_BENCHMARK(BM_Lock);
+POINTERS_BENCHMARK(BM_Expired);
+
+BENCHMARK_TEMPLATE(BM_DestroyGraph, StdPointers)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_DestroyGraph, SingleThreaded)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_DestroyGraph, Atomic)->Range(1 << 10, 1 << 16);
+
+BENCHMARK_MAIN();
@@ -1,4 +1,9 @@
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include "shared_ptr.h"
 
@@ -114,3 +119,305 @@ TEST(Test_4, ResetChecking) {
   EXPECT_TRUE(pointer.Get() == nullptr);
 }
 
+
+TEST(Test_5, ConcurrentCopying) {
+  struct Counted {
+    explicit Counted(std::atomic<int>* destroyed) : destroyed_(destroyed) {}
+    ~Counted() {
+      (*destroyed_)++;
+    }
+    std::atomic<int>* destroyed_;
+  };
+  std::atomic<int> destroyed{0};
+  {
+    pointers::ConcurrentSharedPtr<Counted> origin(new Counted(&destroyed));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 32; ++i) {
+      threads.emplace_back([&origin]() {
+        for (int j = 0; j < 10000; ++j) {
+          pointers::ConcurrentSharedPtr<Counted> copy(origin);
+          pointers::ConcurrentSharedPtr<Counted> moved(std::move(copy));
+          moved.Reset();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(origin.GetCounter(), 1);
+    EXPECT_EQ(destroyed.load(), 0);
+  }
+  EXPECT_EQ(destroyed.load(), 1);
+}
+
+TEST(Test_6, MakeShared) {
+  struct Point {
+    Point(int x, int y) : x(x), y(y) {}
+    int x;
+    int y;
+  };
+  SharedPtr<Point> p_1 = pointers::MakeShared<Point>(3, 4);
+  EXPECT_EQ(p_1->x, 3);
+  EXPECT_EQ(p_1->y, 4);
+  EXPECT_EQ(p_1.GetCounter(), 1);
+  SharedPtr<Point> p_2 = p_1;
+  EXPECT_TRUE(p_1 == p_2);
+  EXPECT_EQ(p_2.GetCounter(), 2);
+  p_1.Reset();
+  EXPECT_EQ(p_2.GetCounter(), 1);
+  EXPECT_EQ((*p_2).x, 3);
+  pointers::ConcurrentSharedPtr<std::string> p_3 =
+      pointers::MakeShared<std::string, pointers::AtomicCounting>(3, 'a');
+  EXPECT_EQ(*p_3, "aaa");
+}
+
+namespace {
+
+struct FreeDeleter {
+  void operator()(int* ptr) const {
+    ptr_deleted_by_free_deleter = ptr;
+    delete ptr;
+  }
+  static int* ptr_deleted_by_free_deleter;
+};
+int* FreeDeleter::ptr_deleted_by_free_deleter = nullptr;
+
+template<typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(int* allocated) : allocated_(allocated) {}
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U>& other)
+      : allocated_(other.allocated_) {}
+
+  T* allocate(std::size_t n) {
+    (*allocated_)++;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, std::size_t n) {
+    (*allocated_)--;
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  int* allocated_;
+};
+
+}  // namespace
+
+TEST(Test_7, CustomDeleters) {
+  using DefaultManager =
+      pointers::PointerCounterManager<int, pointers::SingleThreadedCounting>;
+  using FreeDeleterManager =
+      pointers::PointerCounterManager<int, pointers::SingleThreadedCounting,
+                                      FreeDeleter>;
+  EXPECT_EQ(sizeof(DefaultManager), sizeof(FreeDeleterManager));
+  {
+    int* ptr = new int(5);
+    SharedPtr<int> sptr_1(ptr, FreeDeleter());
+    SharedPtr<int> sptr_2 = sptr_1;
+    sptr_1.Reset();
+    EXPECT_TRUE(FreeDeleter::ptr_deleted_by_free_deleter == nullptr);
+    sptr_2.Reset();
+    EXPECT_TRUE(FreeDeleter::ptr_deleted_by_free_deleter == ptr);
+  }
+  {
+    int pool[4] = {1, 2, 3, 4};
+    int returned = 0;
+    {
+      SharedPtr<int> sptr(&pool[2], [&returned](int* ptr) {
+        returned = *ptr;
+      });
+      EXPECT_EQ(*sptr, 3);
+    }
+    EXPECT_EQ(returned, 3);
+  }
+}
+
+TEST(Test_8, CustomAllocators) {
+  int allocated = 0;
+  {
+    SharedPtr<int> sptr_1(new int(1), pointers::DefaultDelete<int>(),
+                          CountingAllocator<int>(&allocated));
+    EXPECT_EQ(allocated, 1);
+    SharedPtr<int> sptr_2 = pointers::AllocateShared<int>(
+        CountingAllocator<int>(&allocated), 2);
+    EXPECT_EQ(allocated, 2);
+    EXPECT_EQ(*sptr_1 + *sptr_2, 3);
+  }
+  EXPECT_EQ(allocated, 0);
+}
+
+namespace {
+
+struct Base {
+  virtual ~Base() = default;
+  int base_value = 1;
+};
+
+struct Derived : Base {
+  explicit Derived(int* destroyed) : destroyed_(destroyed) {}
+  ~Derived() override {
+    (*destroyed_)++;
+  }
+  int derived_value = 2;
+  int* destroyed_;
+};
+
+}  // namespace
+
+TEST(Test_9, ConvertingConstructors) {
+  int destroyed = 0;
+  {
+    SharedPtr<Derived> derived(new Derived(&destroyed));
+    SharedPtr<Base> base_1(derived);
+    EXPECT_EQ(derived.GetCounter(), 2);
+    EXPECT_TRUE(base_1.Get() == derived.Get());
+    SharedPtr<Base> base_2 = SharedPtr<Derived>(derived);
+    EXPECT_EQ(base_2.GetCounter(), 3);
+    base_2 = std::move(derived);
+    EXPECT_TRUE(derived == nullptr);
+    EXPECT_EQ(base_1.GetCounter(), 2);
+    SharedPtr<Derived> back = pointers::StaticPointerCast<Derived>(base_1);
+    EXPECT_EQ(back->derived_value, 2);
+    EXPECT_EQ(back.GetCounter(), 3);
+    EXPECT_TRUE(pointers::DynamicPointerCast<Derived>(base_2) == back);
+    SharedPtr<Base> not_derived = pointers::MakeShared<Base>();
+    EXPECT_TRUE(pointers::DynamicPointerCast<Derived>(not_derived) == nullptr);
+    EXPECT_EQ(destroyed, 0);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_10, AliasingConstructors) {
+  int destroyed = 0;
+  SharedPtr<int> member;
+  {
+    SharedPtr<Derived> owner(new Derived(&destroyed));
+    member = SharedPtr<int>(owner, &owner->derived_value);
+    EXPECT_EQ(*member, 2);
+    EXPECT_EQ(owner.GetCounter(), 2);
+    SharedPtr<int> other_member(std::move(owner), &owner->base_value);
+    EXPECT_TRUE(owner.Get() == nullptr);
+    EXPECT_EQ(*other_member, 1);
+    EXPECT_EQ(member.GetCounter(), 2);
+    member = std::move(other_member);
+    EXPECT_EQ(*member, 1);
+    EXPECT_EQ(member.GetCounter(), 1);
+  }
+  EXPECT_EQ(destroyed, 0);
+  member.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
+
+namespace {
+
+struct Element {
+  static int alive;
+  static int last_destroyed;
+  // Number of the copy that throws, zero means never.
+  static int throwing_copy;
+  Element() : value(alive++) {}
+  Element(const Element& other) : value(other.value) {
+    if (--throwing_copy == 0) {
+      throw std::runtime_error("copying failed");
+    }
+    alive++;
+  }
+  ~Element() {
+    alive--;
+    last_destroyed = value;
+  }
+  int value;
+};
+
+int Element::alive = 0;
+int Element::last_destroyed = -1;
+int Element::throwing_copy = 0;
+
+}  // namespace
+
+TEST(Test_11, Arrays) {
+  {
+    SharedPtr<int[]> numbers(new int[3]{1, 2, 3});
+    SharedPtr<int[]> copy = numbers;
+    copy[1] = 5;
+    EXPECT_EQ(numbers[0], 1);
+    EXPECT_EQ(numbers[1], 5);
+    EXPECT_EQ(*numbers, 1);
+    EXPECT_EQ(numbers.GetCounter(), 2);
+    SharedPtr<const int[]> const_numbers = numbers;
+    EXPECT_EQ(const_numbers[2], 3);
+    SharedPtr<int> element(numbers, &numbers[2]);
+    EXPECT_EQ(*element, 3);
+  }
+  SharedPtr<double[]> zeros = pointers::MakeSharedArray<double>(1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(zeros[i], 0.0);
+  }
+  SharedPtr<int[], pointers::AtomicCounting> filled =
+      pointers::MakeSharedArray<int, pointers::AtomicCounting>(3, 7);
+  EXPECT_EQ(filled[0] + filled[1] + filled[2], 21);
+  EXPECT_TRUE(pointers::MakeSharedArray<int>(0) != nullptr);
+}
+
+TEST(Test_12, ArrayElementsLifetime) {
+  {
+    SharedPtr<Element[]> elements = pointers::MakeSharedArray<Element>(3);
+    EXPECT_EQ(Element::alive, 3);
+    EXPECT_EQ(elements[2].value, 2);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(elements.Get()) %
+                  alignof(Element), 0u);
+    SharedPtr<Element[]> copy = elements;
+    elements.Reset();
+    EXPECT_EQ(Element::alive, 3);
+  }
+  EXPECT_EQ(Element::alive, 0);
+  EXPECT_EQ(Element::last_destroyed, 0);
+  // The third copy throws, the two made before it must be destroyed.
+  Element value;
+  Element::throwing_copy = 3;
+  EXPECT_THROW(pointers::MakeSharedArray<Element>(4, value),
+               std::runtime_error);
+  EXPECT_EQ(Element::alive, 1);
+}
+
+namespace {
+
+template<typename T>
+struct FailingAllocator {
+  using value_type = T;
+
+  FailingAllocator() = default;
+  template<typename U>
+  FailingAllocator(const FailingAllocator<U>&) {}
+
+  T* allocate(std::size_t) {
+    throw std::bad_alloc();
+  }
+  void deallocate(T*, std::size_t) {}
+};
+
+struct Throwing {
+  Throwing() {
+    throw std::runtime_error("Throwing");
+  }
+};
+
+}  // namespace
+
+TEST(Test_13, ExceptionSafety) {
+  int deleted = 0;
+  EXPECT_THROW(SharedPtr<int>(new int(1), [&deleted](int* ptr) {
+                 ++deleted;
+                 delete ptr;
+               }, FailingAllocator<int>()),
+               std::bad_alloc);
+  EXPECT_EQ(deleted, 1);
+  int allocated = 0;
+  EXPECT_THROW(pointers::AllocateShared<Throwing>(
+                   CountingAllocator<Throwing>(&allocated)),
+               std::runtime_error);
+  EXPECT_EQ(allocated, 0);
+  EXPECT_THROW(pointers::MakeShared<Throwing>(), std::runtime_error);
+}
@@ -0,0 +1,592 @@
+#ifndef UNROLLED_LIST_H_
+#define UNROLLED_LIST_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bidirectional_list.h"
+
+namespace containers {
+
+// Unrolled version of BiDirectionalList: every node (chunk) keeps up to
+// kChunkCapacity values in an array, which takes about two cache lines.
+// Traversal follows one pointer per chunk instead of one per value,
+// and the two pointers of a chunk are shared by all its values.
+// Positions are iterators instead of Node*. Insert and Erase move values
+// inside one or two chunks, so they invalidate iterators to those chunks;
+// PushBack and PushFront may shift the values of the last/first chunk.
+template<typename T, typename Allocator = std::allocator<T>>
+class UnrolledList {
+  struct Chunk;
+
+ public:
+  static constexpr int kChunkCapacity = std::max<int>(
+      4, (128 - 2 * sizeof(void*) - sizeof(int)) / sizeof(T));
+
+  template<bool IsConst>
+  class Iterator {
+   public:
+    friend class UnrolledList;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+
+    Iterator() = default;
+    // iterator -> const_iterator
+    template<bool OtherIsConst,
+             typename = std::enable_if_t<IsConst && !OtherIsConst>>
+    Iterator(const Iterator<OtherIsConst>& other)
+        : chunk_(other.chunk_), index_(other.index_), list_(other.list_) {}
+
+    reference operator*() const {
+      assert(chunk_ != nullptr);
+      return chunk_->Values()[index_];
+    }
+    pointer operator->() const {
+      return &**this;
+    }
+
+    Iterator& operator++() {
+      if (++index_ == chunk_->count) {
+        chunk_ = chunk_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++(*this);
+      return old;
+    }
+    Iterator& operator--() {
+      if (chunk_ == nullptr) {
+        chunk_ = list_->back_;
+        index_ = chunk_->count - 1;
+      } else if (index_ == 0) {
+        chunk_ = chunk_->prev;
+        index_ = chunk_->count - 1;
+      } else {
+        --index_;
+      }
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      --(*this);
+      return old;
+    }
+
+   private:
+    template<bool>
+    friend class Iterator;
+    template<bool LhsIsConst, bool RhsIsConst>
+    friend bool operator==(const Iterator<LhsIsConst>& lhs,
+                           const Iterator<RhsIsConst>& rhs);
+
+    Iterator(Chunk* chunk, int index, const UnrolledList* list)
+        : chunk_(chunk), index_(index), list_(list) {}
+
+    Chunk* chunk_ = nullptr;
+    int index_ = 0;
+    const UnrolledList* list_ = nullptr;
+  };
+
+  // An iterator can be compared with a const_iterator.
+  template<bool LhsIsConst, bool RhsIsConst>
+  friend bool operator==(const Iterator<LhsIsConst>& lhs,
+                         const Iterator<RhsIsConst>& rhs) {
+    return lhs.chunk_ == rhs.chunk_ && lhs.index_ == rhs.index_;
+  }
+  template<bool LhsIsConst, bool RhsIsConst>
+  friend bool operator!=(const Iterator<LhsIsConst>& lhs,
+                         const Iterator<RhsIsConst>& rhs) {
+    return !(lhs == rhs);
+  }
+
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // CONSTRUCTORS
+  UnrolledList() = default;
+  explicit UnrolledList(const Allocator& allocator) : allocator_(allocator) {}
+  UnrolledList(const std::initializer_list<T>& init_list);
+  UnrolledList(UnrolledList&& rhs) noexcept
+      : allocator_(std::move(rhs.allocator_)) {
+    Steal(rhs);
+  }
+  UnrolledList(const UnrolledList& rhs)
+      : allocator_(ChunkTraits::select_on_container_copy_construction(
+            rhs.allocator_)) {
+    (*this) = rhs;
+  }
+  ~UnrolledList() {
+    this->DeleteAll();
+  }
+
+  // GETTERS
+  int Size() const {
+    return size_;
+  }
+  bool IsEmpty() const {
+    return size_ == 0;
+  }
+  std::vector<T> ToVector() const;
+  T& Front() {
+    assert(size_ > 0);
+    return front_->Values()[0];
+  }
+  const T& Front() const {
+    assert(size_ > 0);
+    return front_->Values()[0];
+  }
+  T& Back() {
+    assert(size_ > 0);
+    return back_->Values()[back_->count - 1];
+  }
+  const T& Back() const {
+    assert(size_ > 0);
+    return back_->Values()[back_->count - 1];
+  }
+
+  // ITERATORS
+  iterator begin() {
+    return iterator(front_, 0, this);
+  }
+  const_iterator begin() const {
+    return const_iterator(front_, 0, this);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  iterator end() {
+    return iterator(nullptr, 0, this);
+  }
+  const_iterator end() const {
+    return const_iterator(nullptr, 0, this);
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  // SEARCHING IN LIST
+  int Find(const T& value) const;
+  std::vector<int> FindAll(const T& value) const;
+
+  // Skips whole chunks, so it takes O(index / kChunkCapacity).
+  T& operator[](int index);
+  const T& operator[](int index) const;
+
+  // DELETING METHODS
+  void PopBack();
+  void PopFront();
+  // Returns the iterator to the value after the erased one.
+  iterator Erase(const_iterator position);
+  void DeleteAll();
+
+  // ADDING METHODS
+  void PushBack(T value);
+  void PushFront(T value);
+  // Return the iterator to the new value.
+  iterator InsertBefore(const_iterator position, T value);
+  iterator InsertAfter(const_iterator position, T value) {
+    assert(position != end());
+    return InsertBefore(std::next(position), std::move(value));
+  }
+
+  // COMPARING OPERATORS
+  bool operator==(const UnrolledList& rhs) const;
+  bool operator!=(const UnrolledList& rhs) const {
+    return !(*this == rhs);
+  }
+
+  // ASSIGNMENT OPERATORS
+  UnrolledList& operator=(const UnrolledList& rhs);
+  // Moves values one by one (and may throw) if the allocators are not
+  // equal and the allocator of rhs doesn't propagate.
+  UnrolledList& operator=(UnrolledList&& rhs) noexcept(
+      kIsNothrowMoveAssignable);
+
+ private:
+  struct Chunk {
+    Chunk* prev;
+    Chunk* next;
+    int count;
+    alignas(T) unsigned char storage[kChunkCapacity * sizeof(T)];
+
+    T* Values() {
+      return reinterpret_cast<T*>(storage);
+    }
+  };
+
+  using ChunkAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Chunk>;
+  using ChunkTraits = std::allocator_traits<ChunkAllocator>;
+
+  static constexpr bool kIsNothrowMoveAssignable =
+      ChunkTraits::propagate_on_container_move_assignment::value ||
+      ChunkTraits::is_always_equal::value;
+
+  // Creates an empty chunk and links it after `prev` (or first).
+  Chunk* CreateChunk(Chunk* prev);
+  // Unlinks and frees an empty chunk.
+  void DestroyChunk(Chunk* chunk);
+  // Inserts into a chunk that is not full.
+  static void InsertIntoChunk(Chunk* chunk, int index, T&& value);
+  static void EraseFromChunk(Chunk* chunk, int index);
+  // Moves values [from, count) of the chunk to the end of `to`.
+  static void MoveTail(Chunk* chunk, int from, Chunk* to);
+  void Steal(UnrolledList& rhs);
+
+  ChunkAllocator allocator_;
+  Chunk* front_{nullptr};
+  Chunk* back_{nullptr};
+  int size_ = 0;
+};
+
+template<typename T, typename Allocator>
+UnrolledList<T, Allocator>::UnrolledList(
+    const std::initializer_list<T>& init_list) {
+  for (const T& value : init_list) {
+    this->PushBack(value);
+  }
+}
+
+// GETTERS
+template<typename T, typename Allocator>
+std::vector<T> UnrolledList<T, Allocator>::ToVector() const {
+  std::vector<T> vector_of_values;
+  vector_of_values.reserve(size_);
+  for (Chunk* chunk = front_; chunk != nullptr; chunk = chunk->next) {
+    vector_of_values.insert(vector_of_values.end(), chunk->Values(),
+                            chunk->Values() + chunk->count);
+  }
+  return vector_of_values;
+}
+
+// SEARCHING IN LIST
+template<typename T, typename Allocator>
+int UnrolledList<T, Allocator>::Find(const T& value) const {
+  int index = 0;
+  for (Chunk* chunk = front_; chunk != nullptr; chunk = chunk->next) {
+    const T* values = chunk->Values();
+    for (int i = 0; i < chunk->count; ++i) {
+      if (values[i] == value) {
+        return index + i;
+      }
+    }
+    index += chunk->count;
+  }
+  return -1;
+}
+
+template<typename T, typename Allocator>
+std::vector<int> UnrolledList<T, Allocator>::FindAll(const T& value) const {
+  std::vector<int> indexes_with_value;
+  int index = 0;
+  for (Chunk* chunk = front_; chunk != nullptr; chunk = chunk->next) {
+    const T* values = chunk->Values();
+    for (int i = 0; i < chunk->count; ++i) {
+      if (values[i] == value) {
+        indexes_with_value.push_back(index + i);
+      }
+    }
+    index += chunk->count;
+  }
+  return indexes_with_value;
+}
+
+template<typename T, typename Allocator>
+T& UnrolledList<T, Allocator>::operator[](int index) {
+  assert(index >= 0 && index < size_);
+  Chunk* chunk = front_;
+  while (index >= chunk->count) {
+    index -= chunk->count;
+    chunk = chunk->next;
+  }
+  return chunk->Values()[index];
+}
+
+template<typename T, typename Allocator>
+const T& UnrolledList<T, Allocator>::operator[](int index) const {
+  return const_cast<UnrolledList&>(*this)[index];
+}
+
+// DELETING METHODS
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::PopBack() {
+  assert(size_ > 0);
+  EraseFromChunk(back_, back_->count - 1);
+  --size_;
+  if (back_->count == 0) {
+    DestroyChunk(back_);
+  }
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::PopFront() {
+  assert(size_ > 0);
+  EraseFromChunk(front_, 0);
+  --size_;
+  if (front_->count == 0) {
+    DestroyChunk(front_);
+  }
+}
+
+template<typename T, typename Allocator>
+typename UnrolledList<T, Allocator>::iterator
+    UnrolledList<T, Allocator>::Erase(const_iterator position) {
+  assert(position.list_ == this && position.chunk_ != nullptr);
+  Chunk* chunk = position.chunk_;
+  int index = position.index_;
+  EraseFromChunk(chunk, index);
+  --size_;
+  if (chunk->count == 0) {
+    Chunk* next = chunk->next;
+    DestroyChunk(chunk);
+    return iterator(next, 0, this);
+  }
+  // Chunks less than a quarter full are merged with the next one,
+  // so that they stay dense.
+  Chunk* next = chunk->next;
+  if (next != nullptr && chunk->count < kChunkCapacity / 4 &&
+      chunk->count + next->count <= kChunkCapacity) {
+    MoveTail(next, 0, chunk);
+    DestroyChunk(next);
+  }
+  if (index == chunk->count) {
+    return iterator(chunk->next, 0, this);
+  }
+  return iterator(chunk, index, this);
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::DeleteAll() {
+  if constexpr (std::is_trivially_destructible<T>::value &&
+                CanReleaseAll<ChunkAllocator>::value) {
+    if (allocator_.ReleaseAll()) {
+      front_ = nullptr;
+      back_ = nullptr;
+      size_ = 0;
+      return;
+    }
+  }
+  while (back_ != nullptr) {
+    T* values = back_->Values();
+    for (int i = back_->count; i > 0; --i) {
+      values[i - 1].~T();
+    }
+    back_->count = 0;
+    DestroyChunk(back_);
+  }
+  size_ = 0;
+}
+
+// ADDING METHODS
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::PushBack(T value) {
+  if (back_ == nullptr || back_->count == kChunkCapacity) {
+    CreateChunk(back_);
+  }
+  InsertIntoChunk(back_, back_->count, std::move(value));
+  ++size_;
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::PushFront(T value) {
+  if (front_ == nullptr || front_->count == kChunkCapacity) {
+    CreateChunk(nullptr);
+  }
+  InsertIntoChunk(front_, 0, std::move(value));
+  ++size_;
+}
+
+template<typename T, typename Allocator>
+typename UnrolledList<T, Allocator>::iterator
+    UnrolledList<T, Allocator>::InsertBefore(const_iterator position,
+                                             T value) {
+  assert(position.list_ == this);
+  Chunk* chunk = position.chunk_;
+  int index = position.index_;
+  if (chunk == nullptr) {
+    PushBack(std::move(value));
+    return iterator(back_, back_->count - 1, this);
+  }
+  if (chunk->count == kChunkCapacity) {
+    // Full chunk is split in halves.
+    Chunk* next = CreateChunk(chunk);
+    MoveTail(chunk, kChunkCapacity / 2, next);
+    if (index > chunk->count) {
+      index -= chunk->count;
+      chunk = next;
+    }
+  }
+  InsertIntoChunk(chunk, index, std::move(value));
+  ++size_;
+  return iterator(chunk, index, this);
+}
+
+// COMPARING OPERATORS
+template<typename T, typename Allocator>
+bool UnrolledList<T, Allocator>::operator==(const UnrolledList& rhs) const {
+  if (size_ != rhs.size_) {
+    return false;
+  }
+  return std::equal(begin(), end(), rhs.begin());
+}
+
+// ASSIGNMENT OPERATORS
+template<typename T, typename Allocator>
+UnrolledList<T, Allocator>& UnrolledList<T, Allocator>::operator=(
+    const UnrolledList& rhs) {
+  if (this == &rhs) {
+    return *this;
+  }
+  this->DeleteAll();
+  if constexpr (ChunkTraits::propagate_on_container_copy_assignment::value) {
+    allocator_ = rhs.allocator_;
+  }
+  for (const T& value : rhs) {
+    this->PushBack(value);
+  }
+  return *this;
+}
+
+template<typename T, typename Allocator>
+UnrolledList<T, Allocator>& UnrolledList<T, Allocator>::operator=(
+    UnrolledList&& rhs) noexcept(kIsNothrowMoveAssignable) {
+  if (this == &rhs) {
+    return *this;
+  }
+  this->DeleteAll();
+  if constexpr (ChunkTraits::propagate_on_container_move_assignment::value) {
+    allocator_ = std::move(rhs.allocator_);
+  } else if (allocator_ != rhs.allocator_) {
+    for (T& value : rhs) {
+      this->PushBack(std::move(value));
+    }
+    rhs.DeleteAll();
+    return *this;
+  }
+  Steal(rhs);
+  return *this;
+}
+
+// CHUNKS
+template<typename T, typename Allocator>
+typename UnrolledList<T, Allocator>::Chunk*
+    UnrolledList<T, Allocator>::CreateChunk(Chunk* prev) {
+  Chunk* chunk = new (ChunkTraits::allocate(allocator_, 1)) Chunk;
+  chunk->count = 0;
+  chunk->prev = prev;
+  chunk->next = (prev == nullptr) ? front_ : prev->next;
+  if (chunk->next == nullptr) {
+    back_ = chunk;
+  } else {
+    chunk->next->prev = chunk;
+  }
+  if (prev == nullptr) {
+    front_ = chunk;
+  } else {
+    prev->next = chunk;
+  }
+  return chunk;
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::DestroyChunk(Chunk* chunk) {
+  assert(chunk->count == 0);
+  if (chunk->prev == nullptr) {
+    front_ = chunk->next;
+  } else {
+    chunk->prev->next = chunk->next;
+  }
+  if (chunk->next == nullptr) {
+    back_ = chunk->prev;
+  } else {
+    chunk->next->prev = chunk->prev;
+  }
+  ChunkTraits::deallocate(allocator_, chunk, 1);
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::InsertIntoChunk(Chunk* chunk, int index,
+                                                 T&& value) {
+  assert(chunk->count < kChunkCapacity);
+  T* values = chunk->Values();
+  if (index == chunk->count) {
+    new (values + index) T(std::move(value));
+  } else {
+    new (values + chunk->count) T(std::move(values[chunk->count - 1]));
+    std::move_backward(values + index, values + chunk->count - 1,
+                       values + chunk->count);
+    values[index] = std::move(value);
+  }
+  ++chunk->count;
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::EraseFromChunk(Chunk* chunk, int index) {
+  T* values = chunk->Values();
+  std::move(values + index + 1, values + chunk->count, values + index);
+  values[--chunk->count].~T();
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::MoveTail(Chunk* chunk, int from, Chunk* to) {
+  int moved = chunk->count - from;
+  assert(to->count + moved <= kChunkCapacity);
+  T* values = chunk->Values() + from;
+  T* to_values = to->Values() + to->count;
+  for (int i = 0; i < moved; ++i) {
+    new (to_values + i) T(std::move(values[i]));
+    values[i].~T();
+  }
+  to->count += moved;
+  chunk->count = from;
+}
+
+template<typename T, typename Allocator>
+void UnrolledList<T, Allocator>::Steal(UnrolledList& rhs) {
+  size_ = rhs.size_;
+  back_ = rhs.back_;
+  front_ = rhs.front_;
+  rhs.size_ = 0;
+  rhs.back_ = nullptr;
+  rhs.front_ = nullptr;
+}
+
+// List that takes its chunks from its own NodePoolAllocator.
+template<typename T>
+using PooledUnrolledList = UnrolledList<T, NodePoolAllocator<T>>;
+
+}  // namespace containers
+
+#endif  // UNROLLED_LIST_H_
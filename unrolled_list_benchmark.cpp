@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <memory>
+#include "bidirectional_list.h"
+#include "unrolled_list.h"
+
+using containers::BiDirectionalList;
+using containers::UnrolledList;
+
+namespace {
+
+// Counts the bytes that the list holds, to compare memory per value.
+std::size_t allocated_bytes = 0;
+
+template<typename T>
+class CountingAllocator {
+ public:
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    allocated_bytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, std::size_t n) {
+    allocated_bytes -= n * sizeof(T);
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  template<typename U>
+  bool operator==(const CountingAllocator<U>&) const {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const CountingAllocator<U>&) const {
+    return false;
+  }
+};
+
+template<typename List>
+List MakeList(std::size_t size) {
+  List list;
+  for (std::size_t i = 0; i < size; ++i) {
+    list.PushBack(static_cast<typename List::value_type>(i % 1000));
+  }
+  return list;
+}
+
+template<typename List>
+void BM_Traverse(benchmark::State& state) {
+  List list = MakeList<List>(state.range(0));
+  for (auto _ : state) {
+    typename List::value_type sum = 0;
+    for (const auto& value : list) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<typename List>
+void BM_Find(benchmark::State& state) {
+  List list = MakeList<List>(state.range(0));
+  // The value is not in the list, so the whole list is scanned.
+  auto missing = static_cast<typename List::value_type>(1000);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.Find(missing));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<typename List>
+void BM_ToVector(benchmark::State& state) {
+  List list = MakeList<List>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.ToVector());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Memory of the list divided by the number of values.
+template<typename List>
+void BM_BytesPerValue(benchmark::State& state) {
+  std::size_t before = allocated_bytes;
+  List list = MakeList<List>(state.range(0));
+  double bytes = static_cast<double>(allocated_bytes - before);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.Size());
+  }
+  state.counters["bytes_per_value"] = bytes / state.range(0);
+}
+
+template<typename T>
+using List = BiDirectionalList<T, CountingAllocator<T>>;
+template<typename T>
+using Unrolled = UnrolledList<T, CountingAllocator<T>>;
+
+}  // namespace
+
+#define LIST_BENCHMARK(name, type)                                    \
+  BENCHMARK_TEMPLATE(name, List<type>)->Range(1 << 10, 1 << 20);      \
+  BENCHMARK_TEMPLATE(name, Unrolled<type>)->Range(1 << 10, 1 << 20)
+
+LIST_BENCHMARK(BM_Traverse, int);
+LIST_BENCHMARK(BM_Traverse, double);
+LIST_BENCHMARK(BM_Find, int);
+LIST_BENCHMARK(BM_Find, double);
+LIST_BENCHMARK(BM_ToVector, int);
+LIST_BENCHMARK(BM_ToVector, double);
+
+BENCHMARK_TEMPLATE(BM_BytesPerValue, List<int>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_BytesPerValue, Unrolled<int>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_BytesPerValue, List<double>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_BytesPerValue, Unrolled<double>)->Arg(1 << 16);
+
+BENCHMARK_MAIN();
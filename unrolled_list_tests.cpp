@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "unrolled_list.h"
+#include <gtest/gtest.h>
+
+using containers::UnrolledList;
+
+TEST(Test_0, PushPopTesting) {
+  UnrolledList<int> list({1, 2, 3});
+  EXPECT_EQ(list.Size(), 3);
+  for (int i = 4; i <= 100; ++i) {
+    list.PushBack(i);
+  }
+  for (int i = 0; i > -100; --i) {
+    list.PushFront(i);
+  }
+  EXPECT_EQ(list.Size(), 200);
+  EXPECT_EQ(list.Front(), -99);
+  EXPECT_EQ(list.Back(), 100);
+  EXPECT_EQ(list[99], 0);
+  EXPECT_EQ(list[150], 51);
+  std::vector<int> exp_list(200);
+  std::iota(exp_list.begin(), exp_list.end(), -99);
+  EXPECT_TRUE(list.ToVector() == exp_list);
+  for (int i = 0; i < 100; ++i) {
+    list.PopBack();
+    list.PopFront();
+  }
+  EXPECT_TRUE(list.IsEmpty());
+  EXPECT_TRUE(list.begin() == list.end());
+}
+
+namespace {
+
+// Random insertions and erasures, compared with std::list.
+template<typename T>
+void CompareWithStdList(unsigned seed) {
+  std::mt19937 random(seed);
+  UnrolledList<T> list;
+  std::list<T> exp_list;
+  for (int step = 0; step < 5000; ++step) {
+    int position = static_cast<int>(random() % (exp_list.size() + 1));
+    auto it = std::next(list.begin(), position);
+    auto exp_it = std::next(exp_list.begin(), position);
+    T value = static_cast<T>(std::to_string(step).size() * step);
+    if (random() % 3 != 0 || exp_list.empty()) {
+      auto inserted = list.InsertBefore(it, value);
+      EXPECT_EQ(*inserted, value);
+      exp_list.insert(exp_it, value);
+    } else if (exp_it != exp_list.end()) {
+      auto next = list.Erase(it);
+      auto exp_next = exp_list.erase(exp_it);
+      if (exp_next != exp_list.end()) {
+        EXPECT_EQ(*next, *exp_next);
+      } else {
+        EXPECT_TRUE(next == list.end());
+      }
+    }
+  }
+  EXPECT_EQ(list.Size(), static_cast<int>(exp_list.size()));
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), exp_list.begin(),
+                         exp_list.end()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), exp_list.rbegin(),
+                         exp_list.rend()));
+}
+
+struct Big {
+  Big() = default;
+  explicit Big(std::size_t value) : text(std::to_string(value)) {}
+  bool operator==(const Big& rhs) const {
+    return text == rhs.text;
+  }
+  std::string text;
+  char padding[64] = {};
+};
+
+}  // namespace
+
+TEST(Test_1, InsertEraseChecking) {
+  CompareWithStdList<int>(17);
+  CompareWithStdList<Big>(18);
+}
+
+TEST(Test_2, FindChecking) {
+  UnrolledList<int> list;
+  for (int i = 0; i < 300; ++i) {
+    list.PushBack(i % 100);
+  }
+  EXPECT_EQ(list.Find(42), 42);
+  EXPECT_EQ(list.Find(1000), -1);
+  EXPECT_TRUE(list.FindAll(99) == std::vector<int>({99, 199, 299}));
+  list.InsertAfter(list.begin(), 1000);
+  EXPECT_EQ(list.Find(1000), 1);
+  EXPECT_EQ(list.Find(42), 43);
+}
+
+TEST(Test_3, CopyAndMove) {
+  UnrolledList<std::string> list({"a", "b", "c"});
+  UnrolledList<std::string> copy(list);
+  EXPECT_TRUE(copy == list);
+  copy.PushBack("d");
+  EXPECT_TRUE(copy != list);
+  list = copy;
+  EXPECT_TRUE(copy == list);
+  UnrolledList<std::string> moved(std::move(copy));
+  EXPECT_TRUE(copy.IsEmpty());
+  EXPECT_TRUE(moved == list);
+  list = std::move(moved);
+  EXPECT_EQ(list.Size(), 4);
+  EXPECT_TRUE(moved.IsEmpty());
+}
+
+TEST(Test_4, PooledList) {
+  containers::PooledUnrolledList<double> list;
+  for (int i = 0; i < 10000; ++i) {
+    list.PushBack(i);
+  }
+  containers::PooledUnrolledList<double> copy = list;
+  list.DeleteAll();
+  EXPECT_TRUE(list.IsEmpty());
+  EXPECT_EQ(copy.Size(), 10000);
+  EXPECT_EQ(copy[9999], 9999.0);
+}
+
+TEST(Test_5, MixedIteratorComparison) {
+  UnrolledList<int> list;
+  for (int i = 0; i < 100; ++i) {
+    list.PushBack(i);
+  }
+  UnrolledList<int>::const_iterator middle = std::next(list.cbegin(), 50);
+  EXPECT_TRUE(list.begin() != list.cend());
+  EXPECT_TRUE(list.cbegin() == list.begin());
+  EXPECT_TRUE(std::next(list.begin(), 50) == middle);
+  EXPECT_TRUE(middle != list.end());
+  int count = 0;
+  for (auto it = list.begin(); it != list.cend(); ++it) {
+    ++count;
+  }
+  EXPECT_EQ(count, 100);
+}
+
+namespace {
+
+// Stateful allocator that stays with its container.
+template<typename T>
+struct ArenaAllocator {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+  using is_always_equal = std::false_type;
+
+  explicit ArenaAllocator(int arena) : arena(arena) {}
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(std::size_t n) {
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, std::size_t n) {
+    std::allocator<T>().deallocate(ptr, n);
+  }
+  template<typename U>
+  bool operator==(const ArenaAllocator<U>& rhs) const {
+    return arena == rhs.arena;
+  }
+  template<typename U>
+  bool operator!=(const ArenaAllocator<U>& rhs) const {
+    return arena != rhs.arena;
+  }
+
+  int arena;
+};
+
+}  // namespace
+
+TEST(Test_6, MoveAssignmentWithUnequalAllocators) {
+  using List = UnrolledList<std::string, ArenaAllocator<std::string>>;
+  // Values are moved one by one, which can throw.
+  static_assert(!std::is_nothrow_move_assignable<List>::value);
+  static_assert(std::is_nothrow_move_assignable<UnrolledList<int>>::value);
+  static_assert(std::is_nothrow_move_assignable<
+                containers::PooledUnrolledList<int>>::value);
+  List first{ArenaAllocator<std::string>(1)};
+  for (int i = 0; i < 100; ++i) {
+    first.PushBack(std::to_string(i));
+  }
+  List second{ArenaAllocator<std::string>(2)};
+  second.PushBack("x");
+  second = std::move(first);
+  EXPECT_EQ(second.Size(), 100);
+  EXPECT_EQ(second[99], "99");
+  EXPECT_TRUE(first.IsEmpty());
+}
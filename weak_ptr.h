@@ -1,141 +1,183 @@
 #ifndef WEAK_PTR_H_
 #define WEAK_PTR_H_
 #include "shared_ptr.h"
-#include <cassert>
+#include <type_traits>
 
 namespace pointers {
 
-template<typename T>
+template<typename T, typename CountingPolicy>
 class WeakPtr {
  public:
+  template<typename U, typename Policy>
+  friend class WeakPtr;
+  using Manager = CounterManager<CountingPolicy>;
+  using ElementType = std::remove_extent_t<T>;
+
   // CONSTRUCTORS
   WeakPtr() = default;
-  explicit WeakPtr(const SharedPtr<T>& shared_ptr);
-  WeakPtr(const WeakPtr<T>& other_weak_pointer);
-  WeakPtr(WeakPtr<T>&& another_ptr) noexcept;
+  explicit WeakPtr(const SharedPtr<T, CountingPolicy>& shared_ptr);
+  WeakPtr(const WeakPtr& other_weak_pointer);
+  WeakPtr(WeakPtr&& another_ptr) noexcept;
+  // Converting constructors (e.g. WeakPtr<Derived> -> WeakPtr<Base>).
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  explicit WeakPtr(const SharedPtr<U, CountingPolicy>& shared_ptr);
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  WeakPtr(const WeakPtr<U, CountingPolicy>& other_weak_pointer);
+  template<typename U, typename = std::enable_if_t<
+      std::is_convertible<U*, T*>::value>>
+  WeakPtr(WeakPtr<U, CountingPolicy>&& another_ptr) noexcept;
 
   // DELETING FUNCTIONS
   ~WeakPtr();
   void Reset();
 
   // ASSIGMENT OPERATORS
-  WeakPtr<T>& operator=(const WeakPtr<T>& rhs);
-  WeakPtr<T>& operator=(WeakPtr<T>&& rhs) noexcept;
+  WeakPtr& operator=(const WeakPtr& rhs);
+  WeakPtr& operator=(WeakPtr&& rhs) noexcept;
 
   // INNER POINTER PROCESSING
   bool Expired() const;
-  SharedPtr<T> Lock();
+  // Returns empty pointer if the object is already destroyed.
+  // Can be called concurrently with releasing of the last SharedPtr.
+  SharedPtr<T, CountingPolicy> Lock() const;
 
   // GETTERS
-  T* Get() {
+  ElementType* Get() {
     return weak_inner_pointer_;
   }
-  const T* Get() const {
+  const ElementType* Get() const {
     return weak_inner_pointer_;
   }
   int GetNumberOfConnectedShared() {
     if (get_ == nullptr) {
       return 0;
     }
-    return (get_->counter_of_smart_ptr_);
+    return (get_->GetSharedCounter());
   }
 
  private:
-  T* weak_inner_pointer_{nullptr};
-  CounterManager* get_ = nullptr;
+  ElementType* weak_inner_pointer_{nullptr};
+  Manager* get_ = nullptr;
 };
 
-// CONSTRUCTORS
+// Thread-safe version, works together with ConcurrentSharedPtr.
 template<typename T>
-WeakPtr<T>::WeakPtr(const SharedPtr<T>& shared_ptr) {
+using ConcurrentWeakPtr = WeakPtr<T, AtomicCounting>;
+
+// CONSTRUCTORS
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>::WeakPtr(
+    const SharedPtr<T, CountingPolicy>& shared_ptr) {
   weak_inner_pointer_ = shared_ptr.inner_pointer_;
   get_ = shared_ptr.get_;
   if (get_ != nullptr) {
-    (get_->weak_validity_)++;
+    get_->AddWeak();
   }
 }
 
-template<typename T>
-WeakPtr<T>::WeakPtr(WeakPtr<T>&& another_ptr) noexcept {
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>::WeakPtr(WeakPtr&& another_ptr) noexcept {
   (*this) = std::move(another_ptr);
 }
-template<typename T>
-WeakPtr<T>::WeakPtr(const WeakPtr<T>& other_weak_pointer) {
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>::WeakPtr(const WeakPtr& other_weak_pointer) {
   (*this) = other_weak_pointer;
 }
 
+template<typename T, typename CountingPolicy>
+template<typename U, typename>
+WeakPtr<T, CountingPolicy>::WeakPtr(
+    const SharedPtr<U, CountingPolicy>& shared_ptr) {
+  weak_inner_pointer_ = shared_ptr.inner_pointer_;
+  get_ = shared_ptr.get_;
+  if (get_ != nullptr) {
+    get_->AddWeak();
+  }
+}
+
+template<typename T, typename CountingPolicy>
+template<typename U, typename>
+WeakPtr<T, CountingPolicy>::WeakPtr(
+    const WeakPtr<U, CountingPolicy>& other_weak_pointer) {
+  weak_inner_pointer_ = other_weak_pointer.weak_inner_pointer_;
+  get_ = other_weak_pointer.get_;
+  if (get_ != nullptr) {
+    get_->AddWeak();
+  }
+}
+
+template<typename T, typename CountingPolicy>
+template<typename U, typename>
+WeakPtr<T, CountingPolicy>::WeakPtr(
+    WeakPtr<U, CountingPolicy>&& another_ptr) noexcept {
+  weak_inner_pointer_ = another_ptr.weak_inner_pointer_;
+  get_ = another_ptr.get_;
+  another_ptr.weak_inner_pointer_ = nullptr;
+  another_ptr.get_ = nullptr;
+}
+
 // ASSIGMENT OPERATORS
-template<typename T>
-WeakPtr<T>& WeakPtr<T>::operator=(const WeakPtr<T>& rhs) {
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>& WeakPtr<T, CountingPolicy>::operator=(
+    const WeakPtr& rhs) {
   if (this == &rhs) {
     return (*this);
   }
+  if (rhs.get_ != nullptr) {
+    rhs.get_->AddWeak();
+  }
   this->Reset();
   weak_inner_pointer_ = rhs.weak_inner_pointer_;
   get_ = rhs.get_;
-  if (get_ != nullptr) {
-    (get_->weak_validity_)++;
-  }
   return (*this);
 }
 
-template<typename T>
-WeakPtr<T>& WeakPtr<T>::operator=(WeakPtr<T>&& rhs) noexcept {
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>& WeakPtr<T, CountingPolicy>::operator=(
+    WeakPtr&& rhs) noexcept {
   if (this == &rhs) {
     return (*this);
   }
   this->Reset();
-  weak_inner_pointer_ = std::move(rhs.weak_inner_pointer_);
-  get_ = std::move(rhs.get_);
+  weak_inner_pointer_ = rhs.weak_inner_pointer_;
+  get_ = rhs.get_;
   rhs.weak_inner_pointer_ = nullptr;
   rhs.get_ = nullptr;
   return (*this);
 }
 
 // DESTRUCTORS
-template<typename T>
-WeakPtr<T>::~WeakPtr() {
-  if (get_ != nullptr) {
-    (get_->weak_validity_)--;
-    if (!get_->IsConnectedToPtr()) {
-      delete get_;
-    }
-  }
-  weak_inner_pointer_ = nullptr;
-  get_ = nullptr;
+template<typename T, typename CountingPolicy>
+WeakPtr<T, CountingPolicy>::~WeakPtr() {
+  this->Reset();
 }
 
-template<typename T>
-void WeakPtr<T>::Reset() {
+template<typename T, typename CountingPolicy>
+void WeakPtr<T, CountingPolicy>::Reset() {
   if (get_ != nullptr) {
-    (get_->weak_validity_)--;
-    if (!get_->IsConnectedToPtr()) {
-      delete get_;
-    }
+    get_->ReleaseWeak();
   }
   weak_inner_pointer_ = nullptr;
   get_ = nullptr;
 }
 
 // INNER POINTER PROCESSING
-template<typename T>
-SharedPtr<T> WeakPtr<T>::Lock() {
-  SharedPtr<T> shared_ptr{};
-  if (weak_inner_pointer_ == nullptr) {
-    return shared_ptr;
-  }
-  assert(!this->Expired());
-  shared_ptr.inner_pointer_ = weak_inner_pointer_;
-  shared_ptr.get_ = get_;
-  if (get_ != nullptr) {
-    (get_->counter_of_smart_ptr_)++;
+template<typename T, typename CountingPolicy>
+SharedPtr<T, CountingPolicy> WeakPtr<T, CountingPolicy>::Lock() const {
+  if (get_ == nullptr || weak_inner_pointer_ == nullptr ||
+      !get_->TryAddShared()) {
+    POINTERS_RECORD_REFCOUNT_EVENT(kLockFailure);
+    return SharedPtr<T, CountingPolicy>();
   }
-  return shared_ptr;
+  POINTERS_RECORD_REFCOUNT_EVENT(kLockSuccess);
+  return SharedPtr<T, CountingPolicy>(get_, weak_inner_pointer_);
 }
 
-template<typename T>
-bool WeakPtr<T>::Expired() const {
-  if (get_ == nullptr || get_->counter_of_smart_ptr_ == 0 ||
+template<typename T, typename CountingPolicy>
+bool WeakPtr<T, CountingPolicy>::Expired() const {
+  if (get_ == nullptr || get_->GetSharedCounter() == 0 ||
       weak_inner_pointer_ == nullptr) {
     return true;
   }
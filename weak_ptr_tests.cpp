@@ -3,6 +3,8 @@
 #include "shared_ptr.h"
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 using pointers::WeakPtr;
 using pointers::SharedPtr;
@@ -145,7 +147,7 @@ TEST(Test_7, NullptrCasesOneMoreTime) {
     SharedPtr<int> sptr_1(nullptr);
     WeakPtr<int> w_1(sptr_1);
     EXPECT_TRUE(w_1.Expired());
-    EXPECT_DEATH(w_1.Lock(), ".*");
+    EXPECT_TRUE(w_1.Lock() == nullptr);
     EXPECT_TRUE(w_1.Get() == nullptr);
     int* ptr_1 = new int(7);
     SharedPtr<int> sptr_2(ptr_1);
@@ -154,7 +156,7 @@ TEST(Test_7, NullptrCasesOneMoreTime) {
     w_2 = std::move(w_1);
     EXPECT_TRUE(w_2.GetNumberOfConnectedShared() == 0);
     EXPECT_TRUE(w_1.Expired());
-    EXPECT_DEATH(w_2.Lock(), ".*");
+    EXPECT_TRUE(w_2.Lock() == nullptr);
   }
   {
     int* ptr_1 = new int(-300);
@@ -216,4 +218,116 @@ TEST(Test_8, DifficlutLifetemeTests) {
     WeakPtr<int> w_1;
     EXPECT_TRUE(w_1.Lock() == nullptr);
   }
-}
\ No newline at end of file
+}
+TEST(Test_9, ConcurrentReleasing) {
+  for (int round = 0; round < 1000; ++round) {
+    pointers::ConcurrentSharedPtr<int> sptr(new int(round));
+    pointers::ConcurrentWeakPtr<int> wptr(sptr);
+    std::vector<pointers::ConcurrentSharedPtr<int>> shared(4, sptr);
+    std::vector<pointers::ConcurrentWeakPtr<int>> weak(4, wptr);
+    sptr.Reset();
+    wptr.Reset();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&shared, &weak, i]() {
+        weak[i].Reset();
+        shared[i].Reset();
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
+TEST(Test_10, MakeSharedWithWeak) {
+  struct Counted {
+    explicit Counted(int* destroyed) : destroyed_(destroyed) {}
+    ~Counted() {
+      (*destroyed_)++;
+    }
+    int* destroyed_;
+  };
+  int destroyed = 0;
+  WeakPtr<Counted> wptr;
+  {
+    SharedPtr<Counted> sptr = pointers::MakeShared<Counted>(&destroyed);
+    wptr = WeakPtr<Counted>(sptr);
+    EXPECT_FALSE(wptr.Expired());
+    EXPECT_TRUE(wptr.Lock() == sptr);
+  }
+  EXPECT_EQ(destroyed, 1);
+  EXPECT_TRUE(wptr.Expired());
+  wptr.Reset();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(Test_11, ConvertingConstructors) {
+  struct Base {
+    int value = 1;
+  };
+  struct Derived : Base {
+    int other_value = 2;
+  };
+  SharedPtr<Derived> derived = pointers::MakeShared<Derived>();
+  WeakPtr<Base> weak_1(derived);
+  WeakPtr<Derived> weak_derived(derived);
+  WeakPtr<Base> weak_2(weak_derived);
+  WeakPtr<Base> weak_3(std::move(weak_derived));
+  EXPECT_TRUE(weak_derived.Expired());
+  EXPECT_EQ(weak_1.Lock()->value, 1);
+  EXPECT_TRUE(weak_2.Lock() == weak_3.Lock());
+  derived.Reset();
+  EXPECT_TRUE(weak_1.Expired());
+  EXPECT_TRUE(weak_2.Expired());
+}
+
+TEST(Test_12, LockingExpired) {
+  int* ptr = new int(5);
+  SharedPtr<int> sptr(ptr);
+  const WeakPtr<int> wptr(sptr);
+  EXPECT_TRUE(*wptr.Lock() == 5);
+  sptr.Reset();
+  SharedPtr<int> locked = wptr.Lock();
+  EXPECT_TRUE(locked == nullptr);
+  EXPECT_EQ(locked.GetCounter(), 0);
+  EXPECT_TRUE(wptr.Expired());
+}
+
+TEST(Test_13, ConcurrentLocking) {
+  for (int round = 0; round < 1000; ++round) {
+    pointers::ConcurrentSharedPtr<int> sptr(new int(round));
+    pointers::ConcurrentWeakPtr<int> wptr(sptr);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&wptr, round]() {
+        for (int j = 0; j < 10; ++j) {
+          pointers::ConcurrentSharedPtr<int> locked = wptr.Lock();
+          if (locked.Get() != nullptr) {
+            EXPECT_EQ(*locked, round);
+          }
+        }
+      });
+    }
+    sptr.Reset();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_TRUE(wptr.Expired());
+    EXPECT_TRUE(wptr.Lock() == nullptr);
+  }
+}
+
+TEST(Test_14, Arrays) {
+  WeakPtr<int[]> w_numbers;
+  {
+    SharedPtr<int[]> numbers = pointers::MakeSharedArray<int>(4, 3);
+    w_numbers = WeakPtr<int[]>(numbers);
+    EXPECT_FALSE(w_numbers.Expired());
+    SharedPtr<int[]> locked = w_numbers.Lock();
+    EXPECT_EQ(locked[3], 3);
+    EXPECT_TRUE(locked.Get() == w_numbers.Get());
+  }
+  EXPECT_TRUE(w_numbers.Expired());
+  EXPECT_TRUE(w_numbers.Lock() == nullptr);
+}
@@ -0,0 +1,205 @@
+#ifndef WEAK_VALUE_CACHE_H_
+#define WEAK_VALUE_CACHE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "shared_ptr.h"
+#include "sharding.h"
+#include "weak_ptr.h"
+
+namespace pointers {
+
+struct WeakValueCacheStats {
+  std::size_t size = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  // Entries removed because nobody held their value anymore.
+  std::uint64_t expired_evictions = 0;
+};
+
+// Map from keys to objects that are alive while somebody else holds them,
+// e.g. for deduplication of big immutable objects:
+//   WeakValueCache<std::string, Schema> schemas;
+//   auto schema = schemas.GetOrCreate(text, [&]() { return Parse(text); });
+// The cache keeps only weak pointers, so an entry expires together with
+// the last SharedPtr to its value. Expired entries are removed lazily:
+// when they are found by a lookup, and by a sweep of the shard, which is
+// made when the shard has grown twice since the previous sweep.
+// Keys are spread over shards with their own mutexes.
+template<typename K, typename V, typename Hash = std::hash<K>,
+         typename KeyEqual = std::equal_to<K>>
+class WeakValueCache {
+ public:
+  using Pointer = ConcurrentSharedPtr<V>;
+
+  explicit WeakValueCache(std::size_t shard_count = 16);
+  WeakValueCache(const WeakValueCache&) = delete;
+  WeakValueCache& operator=(const WeakValueCache&) = delete;
+
+  // Returns empty pointer if there is no alive value for the key.
+  Pointer Lock(const K& key);
+  // Returns the alive value for the key or makes a new one with
+  // `factory()` (returning Pointer). Factory is called under the lock
+  // of the shard, so every key has only one value at a time.
+  template<typename Factory>
+  Pointer GetOrCreate(const K& key, Factory&& factory);
+  // Replaces the value of the key.
+  void Insert(const K& key, const Pointer& value);
+  void Erase(const K& key);
+
+  // Removes all expired entries, returns their number.
+  std::size_t Prune();
+
+  WeakValueCacheStats GetStats() const;
+
+ private:
+  using WeakValue = ConcurrentWeakPtr<V>;
+  using Map = std::unordered_map<K, WeakValue, Hash, KeyEqual>;
+
+  struct alignas(sharding::kShardAlignment) Shard {
+    mutable std::mutex mutex;
+    Map entries;
+    // Sweep is made when the shard becomes this big.
+    std::size_t sweep_size = kMinSweepSize;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t expired_evictions = 0;
+  };
+
+  static constexpr std::size_t kMinSweepSize = 64;
+
+  Shard& GetShard(const K& key) {
+    return shards_[sharding::ShardIndex(Hash()(key), shards_.size())];
+  }
+
+  // Must be called under the lock of the shard.
+  static Pointer LockEntry(Shard& shard, typename Map::iterator entry);
+  static std::size_t Sweep(Shard& shard);
+  static void SweepIfGrown(Shard& shard);
+
+  std::vector<Shard> shards_;
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+WeakValueCache<K, V, Hash, KeyEqual>::WeakValueCache(std::size_t shard_count)
+    : shards_(shard_count == 0 ? 1 : shard_count) {}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+typename WeakValueCache<K, V, Hash, KeyEqual>::Pointer
+    WeakValueCache<K, V, Hash, KeyEqual>::Lock(const K& key) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Pointer value = LockEntry(shard, shard.entries.find(key));
+  if (value.Get() == nullptr) {
+    ++shard.misses;
+  } else {
+    ++shard.hits;
+  }
+  return value;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+template<typename Factory>
+typename WeakValueCache<K, V, Hash, KeyEqual>::Pointer
+    WeakValueCache<K, V, Hash, KeyEqual>::GetOrCreate(const K& key,
+                                                      Factory&& factory) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Pointer value = LockEntry(shard, shard.entries.find(key));
+  if (value.Get() != nullptr) {
+    ++shard.hits;
+    return value;
+  }
+  ++shard.misses;
+  value = std::forward<Factory>(factory)();
+  shard.entries.emplace(key, WeakValue(value));
+  SweepIfGrown(shard);
+  return value;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void WeakValueCache<K, V, Hash, KeyEqual>::Insert(const K& key,
+                                                  const Pointer& value) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.entries[key] = WeakValue(value);
+  SweepIfGrown(shard);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void WeakValueCache<K, V, Hash, KeyEqual>::Erase(const K& key) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.entries.erase(key);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+std::size_t WeakValueCache<K, V, Hash, KeyEqual>::Prune() {
+  std::size_t removed = 0;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    removed += Sweep(shard);
+  }
+  return removed;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+WeakValueCacheStats WeakValueCache<K, V, Hash, KeyEqual>::GetStats() const {
+  WeakValueCacheStats stats;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.size += shard.entries.size();
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.expired_evictions += shard.expired_evictions;
+  }
+  return stats;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+typename WeakValueCache<K, V, Hash, KeyEqual>::Pointer
+    WeakValueCache<K, V, Hash, KeyEqual>::LockEntry(
+        Shard& shard, typename Map::iterator entry) {
+  if (entry == shard.entries.end()) {
+    return Pointer();
+  }
+  Pointer value = entry->second.Lock();
+  if (value.Get() == nullptr) {
+    shard.entries.erase(entry);
+    ++shard.expired_evictions;
+  }
+  return value;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+std::size_t WeakValueCache<K, V, Hash, KeyEqual>::Sweep(Shard& shard) {
+  std::size_t removed = 0;
+  for (auto entry = shard.entries.begin(); entry != shard.entries.end();) {
+    if (entry->second.Expired()) {
+      entry = shard.entries.erase(entry);
+      ++removed;
+    } else {
+      ++entry;
+    }
+  }
+  shard.expired_evictions += removed;
+  shard.sweep_size = std::max(kMinSweepSize, 2 * shard.entries.size());
+  return removed;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void WeakValueCache<K, V, Hash, KeyEqual>::SweepIfGrown(Shard& shard) {
+  if (shard.entries.size() >= shard.sweep_size) {
+    Sweep(shard);
+  }
+}
+
+}  // namespace pointers
+
+#endif  // WEAK_VALUE_CACHE_H_
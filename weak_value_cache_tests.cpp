@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "weak_value_cache.h"
+
+using pointers::ConcurrentSharedPtr;
+using pointers::WeakValueCache;
+
+namespace {
+
+struct Schema {
+  explicit Schema(std::string text) : text(std::move(text)) {}
+  std::string text;
+};
+
+ConcurrentSharedPtr<Schema> Parse(const std::string& text) {
+  return pointers::MakeShared<Schema, pointers::AtomicCounting>(text);
+}
+
+}  // namespace
+
+TEST(Test_0, LockAndExpire) {
+  WeakValueCache<std::string, Schema> cache;
+  EXPECT_TRUE(cache.Lock("a").Get() == nullptr);
+  ConcurrentSharedPtr<Schema> schema = Parse("a");
+  cache.Insert("a", schema);
+  EXPECT_TRUE(cache.Lock("a") == schema);
+  EXPECT_EQ(cache.GetStats().size, 1u);
+  schema.Reset();
+  EXPECT_TRUE(cache.Lock("a").Get() == nullptr);
+  pointers::WeakValueCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.size, 0u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.expired_evictions, 1u);
+}
+
+TEST(Test_1, GetOrCreate) {
+  WeakValueCache<std::string, Schema> cache(4);
+  int created = 0;
+  auto factory = [&created]() {
+    ++created;
+    return Parse("b");
+  };
+  ConcurrentSharedPtr<Schema> first = cache.GetOrCreate("b", factory);
+  ConcurrentSharedPtr<Schema> second = cache.GetOrCreate("b", factory);
+  EXPECT_TRUE(first == second);
+  EXPECT_EQ(created, 1);
+  first.Reset();
+  second.Reset();
+  ConcurrentSharedPtr<Schema> third = cache.GetOrCreate("b", factory);
+  EXPECT_EQ(created, 2);
+  EXPECT_EQ(third->text, "b");
+  cache.Erase("b");
+  EXPECT_TRUE(cache.Lock("b").Get() == nullptr);
+}
+
+TEST(Test_2, Pruning) {
+  WeakValueCache<int, Schema> cache(1);
+  std::vector<ConcurrentSharedPtr<Schema>> alive;
+  for (int i = 0; i < 10; ++i) {
+    ConcurrentSharedPtr<Schema> schema = Parse(std::to_string(i));
+    cache.Insert(i, schema);
+    if (i % 2 == 0) {
+      alive.push_back(schema);
+    }
+  }
+  EXPECT_EQ(cache.GetStats().size, 10u);
+  EXPECT_EQ(cache.Prune(), 5u);
+  EXPECT_EQ(cache.GetStats().size, 5u);
+  // Expired entries don't pile up even without lookups.
+  for (int i = 10; i < 10000; ++i) {
+    cache.Insert(i, Parse(std::to_string(i)));
+  }
+  EXPECT_LT(cache.GetStats().size, 200u);
+}
+
+TEST(Test_3, ConcurrentInterning) {
+  WeakValueCache<int, Schema> cache;
+  std::atomic<int> created{0};
+  std::vector<std::thread> threads;
+  std::vector<std::vector<ConcurrentSharedPtr<Schema>>> results(8);
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&cache, &created, &results, i]() {
+      for (int key = 0; key < 1000; ++key) {
+        results[i].push_back(cache.GetOrCreate(key, [&created, key]() {
+          created.fetch_add(1);
+          return Parse(std::to_string(key));
+        }));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(created, 1000);
+  for (int i = 1; i < 8; ++i) {
+    EXPECT_TRUE(results[i] == results[0]);
+  }
+  pointers::WeakValueCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 7000u);
+  EXPECT_EQ(stats.misses, 1000u);
+}